@@ -0,0 +1,87 @@
+#include "attitude.hpp"
+#include "gps.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+void attitude_filter::update(const imu &s, float dt) {
+	++samples;
+	if (dt <= 0) {
+		++skipped;
+		return;
+	}
+
+	auto g = std::array<float, 3>{};
+	for (auto i = 0u; i < g.size(); ++i) {
+		g[i] = to_radians(to_degs_per_sec(s.gyro[i], cfg.gyro_fullscale));
+	}
+
+	auto a = std::array{float(s.acc[0]), float(s.acc[1]), float(s.acc[2])};
+	const auto a_norm2 = a[0] * a[0] + a[1] * a[1] + a[2] * a[2];
+	if (a_norm2 > 0) {
+		const auto inv = 1 / std::sqrt(a_norm2);
+		for (auto &v : a) {
+			v *= inv;
+		}
+		// gravity as the current attitude expects it
+		const auto v = std::array{
+			2 * (q.x * q.z - q.w * q.y),
+			2 * (q.w * q.x + q.y * q.z),
+			q.w * q.w - q.x * q.x - q.y * q.y + q.z * q.z,
+		};
+		const auto e = std::array{
+			a[1] * v[2] - a[2] * v[1],
+			a[2] * v[0] - a[0] * v[2],
+			a[0] * v[1] - a[1] * v[0],
+		};
+		const auto e_norm = std::sqrt(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+		gravity_error = std::asin(std::min(e_norm, 1.f));
+		for (auto i = 0u; i < g.size(); ++i) {
+			integral[i] += cfg.ki * e[i] * dt;
+			g[i] += cfg.kp * e[i] + integral[i];
+		}
+	}
+
+	// q += q * (0, g) * dt / 2
+	const auto h = dt / 2;
+	const auto w = q.w, x = q.x, y = q.y, z = q.z;
+	q.w += (-x * g[0] - y * g[1] - z * g[2]) * h;
+	q.x += (w * g[0] + y * g[2] - z * g[1]) * h;
+	q.y += (w * g[1] - x * g[2] + z * g[0]) * h;
+	q.z += (w * g[2] + x * g[1] - y * g[0]) * h;
+	const auto n2 = q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z;
+	const auto inv = 1 / std::sqrt(n2);
+	q.w *= inv;
+	q.x *= inv;
+	q.y *= inv;
+	q.z *= inv;
+}
+
+auto attitude_filter::euler() const -> std::array<float, 3> {
+	const auto sin_pitch = 2 * (q.w * q.y - q.z * q.x);
+	return {
+		std::atan2(2 * (q.w * q.x + q.y * q.z),
+				   1 - 2 * (q.x * q.x + q.y * q.y)),
+		std::asin(std::clamp(sin_pitch, -1.f, 1.f)),
+		std::atan2(2 * (q.w * q.z + q.x * q.y),
+				   1 - 2 * (q.y * q.y + q.z * q.z)),
+	};
+}
+
+auto attitude_filter::stats() const -> attitude_stats {
+	constexpr auto to_dps = 180 / std::numbers::pi_v<float>;
+	// the integral term compensates the bias, it is its opposite
+	return {
+		.gyro_bias = {-integral[0] * to_dps, -integral[1] * to_dps,
+					  -integral[2] * to_dps},
+		.gravity_error = gravity_error,
+		.samples = samples,
+		.skipped = skipped,
+	};
+}
+
+auto to_turns(const std::array<float, 3> &rad) -> std::array<float, 3> {
+	constexpr auto turn = 2 * std::numbers::pi_v<float>;
+	return {rad[0] / turn, rad[1] / turn, rad[2] / turn};
+}
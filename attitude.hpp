@@ -0,0 +1,57 @@
+#pragma once
+#include "imu.hpp"
+
+#include <array>
+#include <cstddef>
+
+struct quat {
+	float w = 1, x = 0, y = 0, z = 0;
+};
+
+// angles in radians to fractions of a turn, as plot_direction shows them
+auto to_turns(const std::array<float, 3> &rad) -> std::array<float, 3>;
+
+struct attitude_stats {
+	// gyro bias estimated by the integral term, deg/s: the drift the
+	// accelerometer is correcting
+	std::array<float, 3> gyro_bias{};
+	// angle between measured and estimated gravity at the last sample, rad
+	float gravity_error = 0;
+	size_t samples = 0;
+	// samples not integrated, their dt was 0: see device_clock::tick
+	size_t skipped = 0;
+};
+
+// mahony complementary filter on a quaternion: the gyro is integrated over
+// the real time between samples (device_clock::tick of imu::ts), so bursts
+// and dropped lines do not bend the orientation. the accelerometer pulls
+// the estimated gravity back into place, a proportional term for the
+// attitude and an integral one for the gyro bias. yaw has no reference and
+// only stays as good as the gyro is
+class attitude_filter {
+  public:
+	struct config {
+		float kp = 1.f;	 // 1/s, how fast the accelerometer corrects
+		float ki = .05f; // 1/s^2, how fast the bias is learned
+		float gyro_fullscale = 245; // deg/s
+	};
+
+	attitude_filter() : attitude_filter(config{}) {}
+	explicit attitude_filter(const config &c) : cfg{c} {}
+
+	// dt in seconds since the previous sample, 0 to skip the integration
+	void update(const imu &s, float dt);
+
+	auto orientation() const -> const quat & { return q; }
+	// roll, pitch, yaw in radians
+	auto euler() const -> std::array<float, 3>;
+	auto stats() const -> attitude_stats;
+
+  private:
+	config cfg;
+	quat q{};
+	std::array<float, 3> integral{}; // rad/s
+	float gravity_error = 0;
+	size_t samples = 0;
+	size_t skipped = 0;
+};
@@ -0,0 +1,379 @@
+#include "delim_scan.hpp"
+#include "frame.hpp"
+#include "gps.hpp"
+#include "imu.hpp"
+#include "line_buffer.hpp"
+#include "records.hpp"
+
+#include <benchmark/benchmark.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#include "magic_enum.hpp"
+#pragma GCC diagnostic pop
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <ranges>
+#include <string>
+#include <vector>
+
+// the is_imu + to_imu and is_gps_hybrid + to_gps_hybrid pairs as they were
+// before the single pass parsers, kept as the baseline
+namespace legacy {
+constexpr auto is_num(std::string_view sv) {
+	auto ltrim = sv | std::views::drop_while(isspace);
+	auto to_skip = ltrim[0] == '-' ? 1 : 0;
+	return std::ranges::all_of(ltrim.begin() + to_skip, ltrim.end(), isdigit);
+}
+
+auto is_imu(std::string_view sv) -> bool {
+	if (std::ranges::count(sv, ';') != 7) {
+		return false;
+	}
+
+	auto colums =
+		sv | std::views::split(';') | std::views::transform([](auto &&rng) {
+			return std::string_view(&*rng.begin(),
+									size_t(std::ranges::distance(rng)));
+		});
+	if (colums.front() != "imu") {
+		return false;
+	}
+
+	auto nums = colums.begin();
+	++nums;
+	return std::ranges::all_of(nums, colums.end(), is_num);
+}
+
+imu to_imu(std::string_view sv) {
+	spdlog::debug("to_imu: '{}'", sv);
+	auto colums =
+		sv | std::views::split(';') | std::views::transform([](auto &&rng) {
+			auto base = std::string_view(&*rng.begin(),
+										 size_t(std::ranges::distance(rng)));
+			base.remove_prefix(
+				std::min(base.find_first_not_of(" "), base.size()));
+			return base;
+		});
+
+	auto nums = colums | std::views::drop(1) |
+				std::views::transform([](std::string_view strnum) {
+					int64_t res{};
+					auto [_, e] = std::from_chars(
+						strnum.data(), strnum.data() + strnum.size(), res);
+					if (e != std::errc{}) {
+						spdlog::warn("to_imu({}): {}", strnum,
+									 magic_enum::enum_name(e));
+					}
+					return res;
+				});
+
+	std::array<int64_t, 7> v{};
+	std::ranges::copy_n(nums.begin(), 7, v.begin());
+	return imu{uint32_t(v[0]),
+			   {int16_t(v[1]), int16_t(v[2]), int16_t(v[3])},
+			   {int16_t(v[5]), int16_t(v[4]), int16_t(v[6])}};
+}
+
+constexpr auto is_latdir(std::string_view sv) -> bool {
+	auto ltrim = sv | std::views::drop_while(isspace);
+	return ltrim.size() == 1 && (ltrim[0] == 'N' || ltrim[0] == 'S');
+}
+
+constexpr auto to_latdir(std::string_view sv) -> lat_dir {
+	auto ltrim = sv | std::views::drop_while(isspace);
+	return ltrim[0] == 'N' ? lat_dir::N : lat_dir::S;
+}
+constexpr auto to_londir(std::string_view sv) -> lon_dir {
+	auto ltrim = sv | std::views::drop_while(isspace);
+	return ltrim[0] == 'W' ? lon_dir::W : lon_dir::E;
+}
+constexpr auto is_londir(std::string_view sv) -> bool {
+	auto ltrim = sv | std::views::drop_while(isspace);
+	return ltrim.size() == 1 && (ltrim[0] == 'E' || ltrim[0] == 'W');
+}
+
+bool is_gps_hybrid(std::string_view sv) {
+	if (std::ranges::count(sv, ';') != 23) {
+		return false;
+	}
+
+	auto colums =
+		sv | std::views::split(';') | std::views::transform([](auto &&rng) {
+			return std::string_view(&*rng.begin(),
+									size_t(std::ranges::distance(rng)));
+		});
+
+	auto col = colums.begin();
+	for (auto fn : {
+			 +[](std::string_view in) { return in == "gpsrmc"; },
+			 +[](std::string_view in) { return is_num(in); },
+			 +[](std::string_view in) { return is_num(in); },
+			 +[](std::string_view in) { return is_num(in); },
+			 +[](std::string_view in) { return is_num(in); },
+			 +[](std::string_view in) { return is_latdir(in); },
+			 +[](std::string_view in) { return is_num(in); },
+			 +[](std::string_view in) { return is_num(in); },
+			 +[](std::string_view in) { return is_num(in); },
+			 +[](std::string_view in) { return is_londir(in); },
+			 +[](std::string_view in) { return is_num(in); },
+			 +[](std::string_view in) { return is_num(in); },
+			 +[](std::string_view in) { return is_num(in); },
+			 +[](std::string_view in) { return is_num(in); },
+		 }) {
+		if (!fn(*col++)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+auto to_gps_hybrid(std::string_view sv) -> gps_hybrid {
+	constexpr auto to_num = [](std::string_view strnum) {
+		int64_t res = 0;
+		std::from_chars(strnum.data(), strnum.data() + strnum.size(), res);
+		return res;
+	};
+	auto colums =
+		sv | std::views::split(';') | std::views::transform([](auto &&rng) {
+			auto base = std::string_view(&*rng.begin(),
+										 size_t(std::ranges::distance(rng)));
+			base.remove_prefix(
+				std::min(base.find_first_not_of(" "), base.size()));
+			return base;
+		});
+
+	auto col = colums.begin();
+	++col;
+	auto res = gps_hybrid{};
+	res.ts = uint32_t(to_num(*col++));
+	res.pos.lat.deg = uint16_t(to_num(*col++));
+	res.pos.lat.min = uint16_t(to_num(*col++));
+	res.pos.lat.decimal = uint32_t(to_num(*col++));
+	res.pos.latdir = to_latdir(*col++);
+	res.pos.lon.deg = uint16_t(to_num(*col++));
+	res.pos.lon.min = uint16_t(to_num(*col++));
+	res.pos.lon.decimal = uint32_t(to_num(*col++));
+	res.pos.londir = to_londir(*col);
+	return res;
+}
+} // namespace legacy
+
+static auto imu_lines() {
+	auto res = std::vector<std::string>{};
+	for (auto i = 0; i < 1024; ++i) {
+		res.push_back("imu;" + std::to_string(16 * i) + ";" +
+					  std::to_string(i * 7 % 2000 - 1000) + ";" +
+					  std::to_string(-i % 300) + "; 16384;" +
+					  std::to_string(i * 13 % 32000 - 16000) + ";-12;" +
+					  std::to_string(i % 5));
+	}
+	// a few lines of other records, which must be rejected
+	for (auto i = 0; i < 16; ++i) {
+		res[size_t(i * 64)] =
+			"gpsrmc; 193035; 41; 54; 829100; N; 12; 30; 96900; E; 410; "
+			"212830; 210400; 1460;0;0;0;0;0;0;0;0;0;0";
+	}
+	return res;
+}
+
+static void imu_legacy(benchmark::State &state) {
+	const auto lines = imu_lines();
+	for (auto _ : state) {
+		for (const auto &l : lines) {
+			if (legacy::is_imu(l)) {
+				benchmark::DoNotOptimize(legacy::to_imu(l));
+			}
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(lines.size()));
+}
+BENCHMARK(imu_legacy);
+
+static void imu_single_pass(benchmark::State &state) {
+	const auto lines = imu_lines();
+	for (auto _ : state) {
+		for (const auto &l : lines) {
+			benchmark::DoNotOptimize(parse_imu(l));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(lines.size()));
+}
+BENCHMARK(imu_single_pass);
+
+static auto gps_lines() {
+	auto res = std::vector<std::string>{};
+	for (auto i = 0; i < 1024; ++i) {
+		res.push_back("gpsrmc; " + std::to_string(193035 + i) + "; 41; 54; " +
+					  std::to_string(829100 + i * 37) + "; N; 12; 30; " +
+					  std::to_string(96900 + i * 11) + "; E; " +
+					  std::to_string(i % 130) + "; " +
+					  std::to_string(i * 7 % 36000) +
+					  "; 210400; 1460; 0; 0; 0; 0; 0; 0; 0; 0; 0; 0");
+	}
+	// a few lines of other records, which must be rejected
+	for (auto i = 0; i < 16; ++i) {
+		res[size_t(i * 64)] = "imu;16;-12;300;16384;-16000;-12;4";
+	}
+	return res;
+}
+
+static void gps_legacy(benchmark::State &state) {
+	const auto lines = gps_lines();
+	for (auto _ : state) {
+		for (const auto &l : lines) {
+			if (legacy::is_gps_hybrid(l)) {
+				benchmark::DoNotOptimize(legacy::to_gps_hybrid(l));
+			}
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(lines.size()));
+}
+BENCHMARK(gps_legacy);
+
+static void gps_single_pass(benchmark::State &state) {
+	const auto lines = gps_lines();
+	for (auto _ : state) {
+		for (const auto &l : lines) {
+			benchmark::DoNotOptimize(parse_gps_hybrid(l));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(lines.size()));
+}
+BENCHMARK(gps_single_pass);
+
+static auto mixed_lines() {
+	auto res = imu_lines();
+	const auto gps = gps_lines();
+	for (auto i = 0u; i < res.size(); i += 8) {
+		res[i] = gps[i];
+	}
+	return res;
+}
+
+// every decoder tried in sequence, as data_source did before records::parse
+static auto trial_parse(std::string_view l) -> std::optional<record> {
+	if (auto im = parse_imu(l)) {
+		return *im;
+	}
+	if (auto gps = parse_gps_hybrid(l)) {
+		return *gps;
+	}
+	return {};
+}
+
+static void mixed_trial(benchmark::State &state) {
+	const auto lines = mixed_lines();
+	for (auto _ : state) {
+		for (const auto &l : lines) {
+			benchmark::DoNotOptimize(trial_parse(l));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(lines.size()));
+}
+BENCHMARK(mixed_trial);
+
+static void mixed_dispatch(benchmark::State &state) {
+	const auto lines = mixed_lines();
+	for (auto _ : state) {
+		for (const auto &l : lines) {
+			benchmark::DoNotOptimize(records::parse(l));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(lines.size()));
+}
+BENCHMARK(mixed_dispatch);
+
+// the same records as mixed_lines, framed
+static void mixed_frames(benchmark::State &state) {
+	auto bytes = std::vector<char>{};
+	auto count = int64_t{0};
+	for (const auto &l : mixed_lines()) {
+		if (auto r = records::parse(l)) {
+			const auto f = encode_frame(*r);
+			bytes.insert(bytes.end(), f.begin(), f.end());
+			++count;
+		}
+	}
+	for (auto _ : state) {
+		auto n = 0;
+		decode_frames(
+			bytes, [&](const record &) { ++n; }, bytes.size());
+		benchmark::DoNotOptimize(n);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(mixed_frames);
+
+// a capture worth of mixed records pushed through line_buffer in read sized
+// chunks, as the reader thread does
+static void split_lines(benchmark::State &state) {
+	auto capture = std::string{};
+	const auto imu = imu_lines();
+	const auto gps = gps_lines();
+	for (auto i = 0u; i < imu.size(); ++i) {
+		capture += imu[i] + '\n';
+		if (i % 60 == 0) {
+			capture += gps[i] + '\n';
+		}
+	}
+	constexpr auto chunk = size_t{1024};
+
+	for (auto _ : state) {
+		auto buf = line_buffer{};
+		auto lines = size_t{0};
+		for (auto pos = size_t{0}; pos < capture.size(); pos += chunk) {
+			const auto n = std::min(chunk, capture.size() - pos);
+			const auto dest = buf.writable(n);
+			std::copy_n(capture.data() + pos, n, dest.data());
+			buf.commit(n);
+			while (buf.next_line()) {
+				++lines;
+			}
+		}
+		benchmark::DoNotOptimize(lines);
+	}
+	state.SetBytesProcessed(state.iterations() * int64_t(capture.size()));
+	state.SetLabel(std::string(scan_delims_impl()));
+}
+BENCHMARK(split_lines);
+
+// loading a recorded track: one projection per fix
+static auto track_positions() {
+	auto ps = std::vector<DegPos>(64 * 1024);
+	for (auto i = 0u; i < ps.size(); ++i) {
+		ps[i] = {41.9 + 1e-5 * i, 12.5 + 1e-5 * i};
+	}
+	return ps;
+}
+
+static void project_scalar(benchmark::State &state) {
+	const auto ps = track_positions();
+	auto out = std::vector<MercatorePos>(ps.size());
+	for (auto _ : state) {
+		std::ranges::transform(ps, out.begin(), [](const DegPos &p) {
+			return MercatorePos(p);
+		});
+		benchmark::DoNotOptimize(out.data());
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(ps.size()));
+}
+BENCHMARK(project_scalar);
+
+static void project_batch(benchmark::State &state) {
+	const auto ps = track_positions();
+	auto out = std::vector<MercatorePos>(ps.size());
+	for (auto _ : state) {
+		project(ps, out);
+		benchmark::DoNotOptimize(out.data());
+	}
+	state.SetItemsProcessed(state.iterations() * int64_t(ps.size()));
+	state.SetLabel(std::string(project_impl()));
+}
+BENCHMARK(project_batch);
+
+BENCHMARK_MAIN();
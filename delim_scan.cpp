@@ -0,0 +1,93 @@
+#include "delim_scan.hpp"
+
+#include <algorithm>
+#include <array>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LEO_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+using block_fn = delim_masks (*)(const char *);
+
+// full 64 bytes blocks only, scan_delims pads the short ones
+auto scan_scalar(const char *p) -> delim_masks {
+	auto m = delim_masks{};
+	for (auto i = 0u; i < delim_block; ++i) {
+		m.newline |= uint64_t(p[i] == '\n') << i;
+		m.semicolon |= uint64_t(p[i] == ';') << i;
+	}
+	return m;
+}
+
+#ifdef LEO_SCAN_X86
+__attribute__((target("sse2"))) auto scan_sse2(const char *p) -> delim_masks {
+	const auto nl = _mm_set1_epi8('\n');
+	const auto sc = _mm_set1_epi8(';');
+	auto m = delim_masks{};
+	for (auto i = 0u; i < delim_block / 16; ++i) {
+		const auto v =
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * i));
+		const auto eq_nl = _mm_movemask_epi8(_mm_cmpeq_epi8(v, nl));
+		const auto eq_sc = _mm_movemask_epi8(_mm_cmpeq_epi8(v, sc));
+		m.newline |= uint64_t(uint32_t(eq_nl)) << (16 * i);
+		m.semicolon |= uint64_t(uint32_t(eq_sc)) << (16 * i);
+	}
+	return m;
+}
+
+__attribute__((target("avx2"))) auto scan_avx2(const char *p) -> delim_masks {
+	const auto nl = _mm256_set1_epi8('\n');
+	const auto sc = _mm256_set1_epi8(';');
+	const auto lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+	const auto hi =
+		_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 32));
+	// movemask gives an int, go through uint32_t to avoid sign extension
+	const auto nlo = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, nl)));
+	const auto nhi = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, nl)));
+	const auto slo = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, sc)));
+	const auto shi = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, sc)));
+	return {
+		.newline = uint64_t(nlo) | uint64_t(nhi) << 32,
+		.semicolon = uint64_t(slo) | uint64_t(shi) << 32,
+	};
+}
+#endif
+
+struct impl {
+	block_fn fn;
+	std::string_view name;
+};
+
+auto pick() -> impl {
+#ifdef LEO_SCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return {scan_avx2, "avx2"};
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return {scan_sse2, "sse2"};
+	}
+#endif
+	return {scan_scalar, "scalar"};
+}
+
+auto selected() -> const impl & {
+	static const auto s = pick();
+	return s;
+}
+} // namespace
+
+auto scan_delims(std::span<const char> block) -> delim_masks {
+	const auto &s = selected();
+	if (block.size() >= delim_block) {
+		[[likely]] return s.fn(block.data());
+	}
+	// zero padding never matches a delimiter
+	auto padded = std::array<char, delim_block>{};
+	std::copy(block.begin(), block.end(), padded.begin());
+	return s.fn(padded.data());
+}
+
+auto scan_delims_impl() -> std::string_view { return selected().name; }
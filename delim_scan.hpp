@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+// positions of the protocol delimiters inside a block of (at most) 64 bytes:
+// bit i is set when byte i is a '\n' / a ';'
+struct delim_masks {
+	uint64_t newline;
+	uint64_t semicolon;
+};
+
+constexpr auto delim_block = size_t{64};
+
+// vectorized when the cpu allows it (avx2, sse2, scalar fallback), the
+// implementation is picked at runtime on first use
+auto scan_delims(std::span<const char> block) -> delim_masks;
+
+// name of the implementation in use, for logging
+auto scan_delims_impl() -> std::string_view;
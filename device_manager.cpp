@@ -0,0 +1,95 @@
+#include "device_manager.hpp"
+
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+static auto make_reactor() -> std::unique_ptr<io_reactor> {
+#ifdef __linux__
+	try {
+		return std::make_unique<io_reactor>();
+	} catch (const std::exception &e) {
+		spdlog::warn("no io reactor, one thread per port: {}", e.what());
+	}
+#endif
+	return nullptr;
+}
+
+// the reactor is there before discovery starts opening ports on it
+device_manager::device_manager(const read_strategy &s, probe_config c)
+	: reactor{make_reactor()}, strategy{s}, probe{std::move(c)},
+	  mock{std::make_unique<mock_device>()},
+	  caches{source_cache{mock.get()}},
+	  discovery{[this](port p, std::stop_token stop) {
+		  return open(std::move(p), stop);
+	  }} {}
+
+auto device_manager::open(port p, std::stop_token stop) const
+	-> std::unique_ptr<device_samples> {
+	auto o = std::move(p).open();
+	const auto found = probe_port(o, probe, stop);
+	if (is_noise(found, probe)) {
+		throw std::runtime_error(fmt::format(
+			"{} bytes and no records at any of {} baud", found.bytes,
+			fmt::join(probe.bauds, ", ")));
+	}
+	spdlog::info("{}: {} baud, {}", o.name(), found.baud,
+				 found.proto == protocol::binary ? "binary protocol"
+				 : found.proto == protocol::text ? "text protocol"
+				 : found.bytes > 0				 ? "undecided so far"
+												 : "silent so far");
+	o.tune(strategy);
+	auto dev = std::make_unique<device_samples>(std::move(o), found.proto,
+												reactor.get());
+	dev->strategy = strategy;
+	return dev;
+}
+
+void device_manager::take(port_discovery::event &&e) {
+	const auto named = [](const std::string &name) {
+		return [&](const auto &x) { return x.name == name; };
+	};
+	if (auto *o = std::get_if<port_discovery::opened>(&e)) {
+		std::erase_if(failed, named(o->name));
+		devices.push_back(std::move(o->dev));
+		caches.push_back(source_cache{devices.back().get()});
+	} else if (auto *f = std::get_if<port_discovery::failed>(&e)) {
+		failed.push_back({std::move(f->name), std::move(f->error)});
+	} else if (auto *l = std::get_if<port_discovery::lost>(&e)) {
+		std::erase_if(failed, named(l->name));
+		const auto d = std::ranges::find_if(devices, [&](const auto &dev) {
+			return dev->port.name() == l->name;
+		});
+		if (d != devices.end()) {
+			// cache 0 is the mock source
+			const auto i = d - devices.begin();
+			caches.erase(caches.begin() + 1 + i);
+			devices.erase(d);
+		}
+	}
+}
+
+void device_manager::update() {
+	for (auto &e : discovery.take()) {
+		take(std::move(e));
+	}
+	for (auto &c : caches) {
+		c.update();
+	}
+	// a device whose reader stopped is dropped like a lost port, after its
+	// last samples: discovery opens the port again if it is still listed
+	for (auto i = devices.size(); i-- > 0;) {
+		if (devices[i]->shared->alive) {
+			continue;
+		}
+		auto name = devices[i]->port.name();
+		spdlog::warn("{}: reader stopped, dropping the device", name);
+		caches.erase(caches.begin() + 1 + std::ptrdiff_t(i));
+		devices.erase(devices.begin() + std::ptrdiff_t(i));
+		discovery.forget(std::move(name));
+	}
+}
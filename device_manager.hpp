@@ -0,0 +1,70 @@
+#pragma once
+#include "io_reactor.hpp"
+#include "mock_device.hpp"
+#include "port_discovery.hpp"
+#include "port_probe.hpp"
+#include "samples_cache.hpp"
+#include "serial_device.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+using source_cache = samples_cache<mock_device, device_samples>;
+
+// owns every source and its cache. every cache is pulled each frame, not
+// only the one on screen: the rings of the other ports are drained before
+// they fill up and switching source shows up to date data at once.
+// the sources are heap allocated, the caches point at them and the set
+// changes while the caches are in use: ports are found, opened and lost by
+// a port_discovery, update() takes in what it found.
+// on linux all the ports are read by a single io_reactor
+class device_manager {
+  public:
+	// a port that could not be opened
+	struct failure {
+		std::string name;
+		std::string error;
+	};
+
+	// the mock source right away, the serial ports as discovery opens them:
+	// at the baud rate and in the protocol probing finds, read with the
+	// given strategy. ports that send only noise are not opened
+	explicit device_manager(const read_strategy &s = {},
+							probe_config c = {});
+
+	// adds and removes the ports discovery found since the last call,
+	// drains all the sources into their caches, then drops the devices
+	// whose reader stopped
+	void update();
+
+	// the serial ports, in the order of their caches after the mock one
+	auto ports() { return std::span(devices); }
+	auto failures() const -> const std::vector<failure> & { return failed; }
+
+	auto size() const { return caches.size(); }
+	auto operator[](size_t i) -> source_cache & { return caches[i]; }
+	auto operator[](size_t i) const -> const source_cache & {
+		return caches[i];
+	}
+
+  private:
+	// runs on the discovery thread, or on one of its tasks
+	auto open(port p, std::stop_token stop) const
+		-> std::unique_ptr<device_samples>;
+	void take(port_discovery::event &&e);
+
+	// null where there is no reactor: every port has a reader thread
+	std::unique_ptr<io_reactor> reactor{};
+	read_strategy strategy;
+	probe_config probe;
+	std::unique_ptr<mock_device> mock;
+	std::vector<std::unique_ptr<device_samples>> devices{};
+	std::vector<source_cache> caches{};
+	std::vector<failure> failed{};
+	// declared last: stopped before the reactor it opens ports on is gone
+	port_discovery discovery;
+};
@@ -0,0 +1,109 @@
+#pragma once
+#include "delim_scan.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// single pass scanner over a ';' separated record.
+// every accessor consumes exactly one field (and its delimiter) and returns
+// false as soon as the field does not match, so validation and decoding
+// happen in the same sweep. leading spaces inside a field are skipped
+struct field_scanner {
+	std::string_view sv;
+	size_t pos = 0;
+	bool ended = false;
+
+	constexpr explicit field_scanner(std::string_view line) : sv{line} {}
+
+	// true once the last field has been consumed and nothing follows
+	constexpr auto done() const -> bool { return ended; }
+
+	// the field must be exactly t
+	constexpr auto tag(std::string_view t) -> bool {
+		if (ended || sv.substr(pos, t.size()) != t) {
+			return false;
+		}
+		pos += t.size();
+		return delim();
+	}
+
+	// [spaces][-]digits, at most 18 digits so that it cannot overflow
+	constexpr auto num(int64_t &out) -> bool {
+		skip_spaces();
+		const auto neg = pos < sv.size() && sv[pos] == '-';
+		pos += neg ? 1 : 0;
+
+		auto acc = int64_t{0};
+		const auto first = pos;
+		for (; pos < sv.size() && sv[pos] >= '0' && sv[pos] <= '9'; ++pos) {
+			acc = acc * 10 + (sv[pos] - '0');
+		}
+		const auto digits = pos - first;
+		if (digits == 0 || digits > 18) {
+			return false;
+		}
+		out = neg ? -acc : acc;
+		return delim();
+	}
+
+	// [spaces] then a single char, either a or b
+	constexpr auto one_of(char a, char b, char &out) -> bool {
+		skip_spaces();
+		if (pos == sv.size() || (sv[pos] != a && sv[pos] != b)) {
+			return false;
+		}
+		out = sv[pos++];
+		return delim();
+	}
+
+	// consumes n fields whatever their content, jumping from ';' to ';' with
+	// the semicolon masks of scan_delims
+	auto skip(size_t n = 1) -> bool {
+		if (ended) {
+			return n == 0;
+		}
+		while (n > 0) {
+			const auto rest = sv.substr(pos);
+			auto m = scan_delims(rest).semicolon;
+			const auto found = size_t(std::popcount(m));
+			if (found >= n) {
+				for (; n > 1; --n) {
+					m &= m - 1;
+				}
+				pos += size_t(std::countr_zero(m)) + 1;
+				return true;
+			}
+			if (rest.size() <= delim_block) {
+				// the last field runs to the end of the line
+				pos = sv.size();
+				ended = found + 1 == n;
+				return ended;
+			}
+			n -= found;
+			pos += delim_block;
+		}
+		return true;
+	}
+
+  private:
+	constexpr void skip_spaces() {
+		while (pos < sv.size() && (sv[pos] == ' ' || sv[pos] == '\t')) {
+			++pos;
+		}
+	}
+
+	// a field ends on ';' (consumed) or at the end of the line
+	constexpr auto delim() -> bool {
+		if (pos == sv.size()) {
+			ended = true;
+			return true;
+		}
+		if (sv[pos] == ';') {
+			++pos;
+			return true;
+		}
+		return false;
+	}
+};
@@ -0,0 +1,191 @@
+#include "frame.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+
+static_assert(std::endian::native == std::endian::little,
+			  "frame payloads are memcpy'd, a big endian host needs swaps");
+static_assert(sizeof(imu) == 16 && std::is_trivially_copyable_v<imu>,
+			  "imu is sent as its in-memory representation");
+
+// gps_hybrid payload, little endian, no padding
+//  0 ts u32 | 4 lat deg u16 | 6 lat min u16 | 8 lat decimal u32
+// 12 lat dir i8 (+1 N, -1 S) | 13 lon deg u16 | 15 lon min u16
+// 17 lon decimal u32 | 21 lon dir i8 (+1 E, -1 W) | 22 speed kmh i32
+// 26 heading i32 | 30 altitude mm i32 | 34 hdop i32
+constexpr auto gps_payload = size_t{38};
+
+static constexpr auto crc_table = [] {
+	auto t = std::array<uint16_t, 256>{};
+	for (auto i = 0u; i < t.size(); ++i) {
+		auto c = uint16_t(i << 8);
+		for (auto b = 0; b < 8; ++b) {
+			c = uint16_t((c & 0x8000) ? (c << 1) ^ 0x1021 : c << 1);
+		}
+		t[i] = c;
+	}
+	return t;
+}();
+
+auto crc16(std::span<const char> bytes) -> uint16_t {
+	auto crc = uint16_t{0xFFFF};
+	for (const auto b : bytes) {
+		crc = uint16_t(crc << 8) ^ crc_table[(crc >> 8) ^ uint8_t(b)];
+	}
+	return crc;
+}
+
+template <typename T> static auto get(const char *&p) -> T {
+	T v;
+	std::memcpy(&v, p, sizeof(T));
+	p += sizeof(T);
+	return v;
+}
+
+template <typename T> static void put(std::vector<char> &out, T v) {
+	const auto old = out.size();
+	out.resize(old + sizeof(T));
+	std::memcpy(out.data() + old, &v, sizeof(T));
+}
+
+static auto payload_size(frame_type t) -> std::optional<size_t> {
+	switch (t) {
+	case frame_type::imu:
+		return sizeof(imu);
+	case frame_type::gps_hybrid:
+		return gps_payload;
+	}
+	return {};
+}
+
+static auto decode_gps(const char *p) -> gps_hybrid {
+	auto g = gps_hybrid{};
+	g.ts = get<uint32_t>(p);
+	g.pos.lat.deg = get<uint16_t>(p);
+	g.pos.lat.min = get<uint16_t>(p);
+	g.pos.lat.decimal = get<uint32_t>(p);
+	g.pos.latdir = get<int8_t>(p) < 0 ? lat_dir::S : lat_dir::N;
+	g.pos.lon.deg = get<uint16_t>(p);
+	g.pos.lon.min = get<uint16_t>(p);
+	g.pos.lon.decimal = get<uint32_t>(p);
+	g.pos.londir = get<int8_t>(p) < 0 ? lon_dir::W : lon_dir::E;
+	g.speed_kmh = get<int32_t>(p);
+	g.heading = get<int32_t>(p);
+	g.altitude_mm = get<int32_t>(p);
+	g.hdop = get<int32_t>(p);
+	return g;
+}
+
+auto parse_frame(std::span<const char> bytes) -> frame_parse {
+	if (bytes.size() < frame_header) {
+		return {frame_status::need_more, 0, {}};
+	}
+	if (uint8_t(bytes[0]) != frame_sync[0] ||
+		uint8_t(bytes[1]) != frame_sync[1]) {
+		return {frame_status::bad, 0, {}};
+	}
+
+	const auto type = frame_type(uint8_t(bytes[2]));
+	const auto len = size_t(uint8_t(bytes[3]));
+	const auto expected = payload_size(type);
+	if (expected && *expected != len) {
+		return {frame_status::bad, 0, {}};
+	}
+	const auto size = frame_overhead + len;
+	if (bytes.size() < size) {
+		return {frame_status::need_more, 0, {}};
+	}
+
+	auto crc_p = bytes.data() + frame_header + len;
+	if (crc16(bytes.subspan(2, 2 + len)) != get<uint16_t>(crc_p)) {
+		return {frame_status::bad, 0, {}};
+	}
+
+	const auto payload = bytes.data() + frame_header;
+	switch (type) {
+	case frame_type::imu: {
+		auto im = imu{};
+		std::memcpy(&im, payload, sizeof(imu));
+		return {frame_status::ok, size, im};
+	}
+	case frame_type::gps_hybrid:
+		return {frame_status::ok, size, decode_gps(payload)};
+	}
+	// valid frame of a type we do not know (yet)
+	return {frame_status::ok, size, {}};
+}
+
+auto encode_frame(const record &r) -> std::vector<char> {
+	auto out = std::vector<char>{};
+	out.reserve(frame_overhead + gps_payload);
+	put(out, frame_sync);
+	if (std::holds_alternative<imu>(r)) {
+		put(out, frame_type::imu);
+		put(out, uint8_t(sizeof(imu)));
+		put(out, std::get<imu>(r));
+	} else {
+		const auto &g = std::get<gps_hybrid>(r);
+		put(out, frame_type::gps_hybrid);
+		put(out, uint8_t(gps_payload));
+		put(out, g.ts);
+		put(out, g.pos.lat.deg);
+		put(out, g.pos.lat.min);
+		put(out, g.pos.lat.decimal);
+		put(out, int8_t(g.pos.latdir));
+		put(out, g.pos.lon.deg);
+		put(out, g.pos.lon.min);
+		put(out, g.pos.lon.decimal);
+		put(out, int8_t(g.pos.londir));
+		put(out, g.speed_kmh);
+		put(out, g.heading);
+		put(out, g.altitude_mm);
+		put(out, g.hdop);
+	}
+	put(out, crc16(std::span(out).subspan(2)));
+	return out;
+}
+
+auto find_sync(std::span<const char> bytes) -> size_t {
+	const auto first = char(frame_sync[0]);
+	for (auto it = std::find(bytes.begin(), bytes.end(), first);
+		 it != bytes.end(); it = std::find(it + 1, bytes.end(), first)) {
+		if (it + 1 == bytes.end() || uint8_t(*(it + 1)) == frame_sync[1]) {
+			return size_t(it - bytes.begin());
+		}
+	}
+	return bytes.size();
+}
+
+auto protocol_score::best(size_t evidence) const -> protocol {
+	if (records() < evidence) {
+		return protocol::autodetect;
+	}
+	return frames >= lines ? protocol::binary : protocol::text;
+}
+
+auto score_protocols(std::span<const char> bytes) -> protocol_score {
+	auto s = protocol_score{};
+	s.frames = decode_frames(
+				   bytes, [](const record &) {},
+				   std::numeric_limits<size_t>::max())
+				   .frames;
+
+	const auto text = std::string_view(bytes.data(), bytes.size());
+	for (auto from = size_t{0}, nl = text.find('\n'); nl != text.npos;
+		 from = nl + 1, nl = text.find('\n', from)) {
+		if (records::parse(text.substr(from, nl - from))) {
+			++s.lines;
+		}
+	}
+	return s;
+}
+
+auto detect_protocol(std::span<const char> bytes) -> protocol {
+	// a handful of crc checked frames or of parsable lines is plenty
+	constexpr auto evidence = size_t{3};
+	return score_protocols(bytes).best(evidence);
+}
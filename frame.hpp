@@ -0,0 +1,94 @@
+#pragma once
+#include "records.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+// binary framing of the records, as an alternative to the text lines:
+//   0xA5 0x5A | type (u8) | length (u8) | payload | crc16 (le)
+// the crc (CCITT, init 0xFFFF) covers type, length and payload.
+// payloads are little endian: imu is its 16 bytes in memory order,
+// gps_hybrid is listed in frame.cpp
+enum class frame_type : uint8_t { imu = 1, gps_hybrid = 2 };
+
+constexpr auto frame_sync = std::array<uint8_t, 2>{0xA5, 0x5A};
+constexpr auto frame_header = size_t{4};
+constexpr auto frame_overhead = frame_header + 2;
+
+auto crc16(std::span<const char> bytes) -> uint16_t;
+
+enum class frame_status { ok, need_more, bad };
+struct frame_parse {
+	frame_status status;
+	size_t size; // whole frame, valid when ok
+	std::optional<record> rec; // empty for a valid frame of unknown type
+};
+
+// looks at a frame starting exactly at bytes[0]
+auto parse_frame(std::span<const char> bytes) -> frame_parse;
+
+auto encode_frame(const record &r) -> std::vector<char>;
+
+// offset of the next sync word (or of a trailing 0xA5 that may start one)
+auto find_sync(std::span<const char> bytes) -> size_t;
+
+struct frame_scan {
+	size_t consumed = 0; // bytes that can be dropped from the input
+	size_t frames = 0;
+	size_t skipped = 0; // garbage between frames
+	size_t errors = 0;	// sync found but bad length or crc
+};
+
+// decodes every complete frame in bytes (at most budget of them) calling
+// f(const record &), resynchronizing on the sync word after garbage.
+// an incomplete frame at the end is not consumed
+template <typename F>
+auto decode_frames(std::span<const char> bytes, F &&f, size_t budget)
+	-> frame_scan {
+	auto res = frame_scan{};
+	while (res.frames < budget) {
+		const auto sync = find_sync(bytes.subspan(res.consumed));
+		res.skipped += sync;
+		res.consumed += sync;
+
+		const auto p = parse_frame(bytes.subspan(res.consumed));
+		if (p.status == frame_status::need_more) {
+			break;
+		}
+		if (p.status == frame_status::bad) {
+			++res.errors;
+			++res.skipped;
+			++res.consumed;
+			continue;
+		}
+		res.consumed += p.size;
+		++res.frames;
+		if (p.rec) {
+			f(*p.rec);
+		}
+	}
+	return res;
+}
+
+enum class protocol { autodetect, text, binary };
+
+// how well a window of received bytes decodes in either protocol: crc
+// checked frames and lines that parse as records. noise, as a port at the
+// wrong baud rate receives, produces neither
+struct protocol_score {
+	size_t frames = 0;
+	size_t lines = 0;
+
+	auto records() const { return frames > lines ? frames : lines; }
+	// the protocol with more records, autodetect below evidence of them
+	auto best(size_t evidence) const -> protocol;
+};
+auto score_protocols(std::span<const char> bytes) -> protocol_score;
+
+// looks at a window of received bytes and decides which protocol it is
+// speaking, autodetect if there is not enough evidence yet
+auto detect_protocol(std::span<const char> bytes) -> protocol;
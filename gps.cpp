@@ -1,96 +1,99 @@
 #include "gps.hpp"
+#include "field_scanner.hpp"
 
 #include <algorithm>
-#include <charconv>
 #include <cmath>
 #include <cstdlib>
 #include <numbers>
 #include <numeric>
 
-constexpr auto deg2rad(auto a) {
-	return a / (180.f / std::numbers::pi_v<float>);
+template <std::floating_point T> constexpr auto deg2rad(T a) {
+	return a / (T(180) / std::numbers::pi_v<T>);
 }
 
-constexpr auto rad2deg(auto a) {
-	return a * (180.f / std::numbers::pi_v<float>);
+template <std::floating_point T> constexpr auto rad2deg(T a) {
+	return a * (T(180) / std::numbers::pi_v<T>);
 }
 
-constexpr auto earth_radius = 6378137.f;
+constexpr auto earth_radius = 6378137.;
 
 /* The following functions take their parameter and return their result in
  * degrees */
 
-auto y2lat_d(auto y) {
+template <std::floating_point T> auto y2lat_d(T y) {
 	return rad2deg(std::atan(std::exp(deg2rad(y))) * 2 -
-				   std::numbers::pi_v<float> / 2);
+				   std::numbers::pi_v<T> / 2);
 }
 
-constexpr auto x2lon_d(auto x) { return x; }
+template <std::floating_point T> constexpr auto x2lon_d(T x) { return x; }
 
-auto lat2y_d(auto lat) {
+template <std::floating_point T> auto lat2y_d(T lat) {
 	return rad2deg(
-		std::log(std::tan(deg2rad(lat) / 2 + std::numbers::pi_v<float> / 4)));
+		std::log(std::tan(deg2rad(lat) / 2 + std::numbers::pi_v<T> / 4)));
 }
 
-constexpr auto lon2x_d(auto lon) { return lon; }
+template <std::floating_point T> constexpr auto lon2x_d(T lon) { return lon; }
 
 /* The following functions take their parameter in something close to meters,
  * along the equator, and return their result in degrees */
 
-auto y2lat_m(auto y) {
-	return rad2deg(2 * std::atan(std::exp(y / earth_radius)) -
-				   std::numbers::pi_v<float> / 2);
+template <std::floating_point T> auto y2lat_m(T y) {
+	return rad2deg(2 * std::atan(std::exp(y / T(earth_radius))) -
+				   std::numbers::pi_v<T> / 2);
 }
 
-auto x2lon_m(auto x) { return rad2deg(x / earth_radius); }
+template <std::floating_point T> auto x2lon_m(T x) {
+	return rad2deg(x / T(earth_radius));
+}
 
 /* The following functions take their parameter in degrees, and return their
  * result in something close to meters, along the equator */
 
-auto lat2y_m(auto lat) {
-	return std::log(
-			   std::tan(deg2rad(lat) / 2 + std::numbers::pi_v<float> / 4)) *
-		   earth_radius;
+template <std::floating_point T> auto lat2y_m(T lat) {
+	return std::log(std::tan(deg2rad(lat) / 2 + std::numbers::pi_v<T> / 4)) *
+		   T(earth_radius);
 }
 
-auto lon2x_m(auto lon) { return deg2rad(lon) * earth_radius; }
-
-DMMPos::operator DegPos() const {
-	return {
-		.lat = float(latdir) * lat.to_deg(),
-		.lon = float(londir) * lon.to_deg(),
-	};
+template <std::floating_point T> auto lon2x_m(T lon) {
+	return deg2rad(lon) * T(earth_radius);
 }
 
-DegPos::operator MercatorePos() const {
+template <std::floating_point T>
+basic_deg_pos<T>::operator basic_mercator_pos<T>() const {
 	return {
 		.x = lon2x_d(lon),
 		.y = lat2y_d(lat),
 	};
 }
 
-constexpr auto is_num(std::string_view sv) -> bool {
-	auto ltrim = sv | std::views::drop_while(isspace);
-	auto to_skip = ltrim[0] == '-' ? 1 : 0;
-	return std::ranges::all_of(ltrim.begin() + to_skip, ltrim.end(), isdigit);
-}
+template struct basic_deg_pos<double>;
 
-constexpr auto is_latdir(std::string_view sv) -> bool {
-	auto ltrim = sv | std::views::drop_while(isspace);
-	return ltrim.size() == 1 && (ltrim[0] == 'N' || ltrim[0] == 'S');
-}
+// WGS84
+constexpr auto wgs84_e2 = 6.69437999014e-3;
 
-constexpr auto to_latdir(std::string_view sv) -> lat_dir {
-	auto ltrim = sv | std::views::drop_while(isspace);
-	return ltrim[0] == 'N' ? lat_dir::N : lat_dir::S;
+local_tangent_plane::local_tangent_plane(const DegPos &origin)
+	: origin_{origin}, sin_lat{std::sin(deg2rad(origin.lat))},
+	  cos_lat{std::cos(deg2rad(origin.lat))},
+	  sin_lon{std::sin(deg2rad(origin.lon))},
+	  cos_lon{std::cos(deg2rad(origin.lon))} {
+	const auto n = earth_radius / std::sqrt(1 - wgs84_e2 * sin_lat * sin_lat);
+	ox = n * cos_lat * cos_lon;
+	oy = n * cos_lat * sin_lon;
+	oz = n * (1 - wgs84_e2) * sin_lat;
 }
-constexpr auto to_londir(std::string_view sv) -> lon_dir {
-	auto ltrim = sv | std::views::drop_while(isspace);
-	return ltrim[0] == 'W' ? lon_dir::W : lon_dir::E;
-}
-constexpr auto is_londir(std::string_view sv) -> bool {
-	auto ltrim = sv | std::views::drop_while(isspace);
-	return ltrim.size() == 1 && (ltrim[0] == 'E' || ltrim[0] == 'W');
+
+auto local_tangent_plane::project(const DegPos &p) const -> enu_pos {
+	const auto sl = std::sin(deg2rad(p.lat)), cl = std::cos(deg2rad(p.lat));
+	const auto so = std::sin(deg2rad(p.lon)), co = std::cos(deg2rad(p.lon));
+	const auto n = earth_radius / std::sqrt(1 - wgs84_e2 * sl * sl);
+	const auto dx = n * cl * co - ox;
+	const auto dy = n * cl * so - oy;
+	const auto dz = n * (1 - wgs84_e2) * sl - oz;
+	return {
+		.east = -sin_lon * dx + cos_lon * dy,
+		.north =
+			-sin_lat * (cos_lon * dx + sin_lon * dy) + cos_lat * dz,
+	};
 }
 
 /*
@@ -99,83 +102,56 @@ constexpr auto is_londir(std::string_view sv) -> bool {
 			int(om), int32_t(odd), lond, int32_t(store.v->ground_speed_kmh),
 			int32_t(store.r->heading), int32_t(store.g->altitude_mm),
 			int32_t(store.g->hdop));
+ * followed by 10 more columns that are not decoded (24 in total)
  */
-bool is_gps_hybrid(std::string_view sv) {
-	if (std::ranges::count(sv, ';') != 23) {
-		return false;
+auto parse_gps_hybrid(std::string_view sv) -> std::optional<gps_hybrid> {
+	auto f = field_scanner{sv};
+	if (!f.tag("gpsrmc")) {
+		return {};
 	}
+	return parse_gps_hybrid_fields(sv.substr(f.pos));
+}
 
-	auto colums =
-		sv | std::views::split(';') | std::views::transform([](auto &&rng) {
-			return std::string_view(&*rng.begin(),
-									size_t(std::ranges::distance(rng)));
-		});
-
-	auto col = colums.begin();
-	for (auto fn : {
-			 +[](std::string_view in) { return in == "gpsrmc"; },
-			 is_num,
-			 is_num,
-			 is_num,
-			 is_num,
-			 is_latdir,
-			 is_num,
-			 is_num,
-			 is_num,
-			 is_londir,
-			 is_num,
-			 is_num,
-			 is_num,
-			 is_num,
-		 }) {
-		if (!fn(*col++)) {
-			return false;
-		}
+auto parse_gps_hybrid_fields(std::string_view sv)
+	-> std::optional<gps_hybrid> {
+	constexpr auto trailing_columns = size_t{10};
+
+	auto f = field_scanner{sv};
+	int64_t ts, lat_d, lat_m, lat_dec, lon_d, lon_m, lon_dec;
+	int64_t speed, heading, altitude, hdop;
+	char lat_c, lon_c;
+	if (!(f.num(ts) && f.num(lat_d) && f.num(lat_m) &&
+		  f.num(lat_dec) && f.one_of('N', 'S', lat_c) && f.num(lon_d) &&
+		  f.num(lon_m) && f.num(lon_dec) && f.one_of('E', 'W', lon_c) &&
+		  f.num(speed) && f.num(heading) && f.num(altitude) && f.num(hdop))) {
+		return {};
+	}
+	if (!(f.skip(trailing_columns) && f.done())) {
+		return {};
 	}
-	return true;
-
-	return *col++ == "gpsrmc" && is_num(*col++) && is_num(*col++) &&
-		   is_num(*col++) && is_num(*col++) && is_latdir(*col++) &&
-		   is_num(*col++) && is_num(*col++) && is_num(*col++) &&
-		   is_londir(*col++) && is_num(*col++) && is_num(*col++) &&
-		   is_num(*col++) && is_num(*col);
-}
 
-auto to_gps_hybrid(std::string_view sv) -> gps_hybrid {
-	constexpr auto to_num = [](std::string_view strnum) {
-		int64_t res = 0;
-		std::from_chars(strnum.data(), strnum.data() + strnum.size(), res);
-		return res;
-	};
-	auto colums =
-		sv | std::views::split(';') | std::views::transform([](auto &&rng) {
-			auto base = std::string_view(&*rng.begin(),
-										 size_t(std::ranges::distance(rng)));
-			base.remove_prefix(
-				std::min(base.find_first_not_of(" "), base.size()));
-			return base;
-		});
-
-	auto col = colums.begin();
-	++col;
-	return {
-		.ts = uint32_t(to_num(*col++)),
+	return gps_hybrid{
+		.ts = uint32_t(ts),
 		.pos =
 			{
 				.lat =
 					{
-						.deg = uint16_t(to_num(*col++)),
-						.min = uint16_t(to_num(*col++)),
-						.decimal = uint32_t(to_num(*col++)),
+						.deg = uint16_t(lat_d),
+						.min = uint16_t(lat_m),
+						.decimal = uint32_t(lat_dec),
 					},
-				.latdir = to_latdir(*col++),
+				.latdir = lat_c == 'N' ? lat_dir::N : lat_dir::S,
 				.lon =
 					{
-						.deg = uint16_t(to_num(*col++)),
-						.min = uint16_t(to_num(*col++)),
-						.decimal = uint32_t(to_num(*col++)),
+						.deg = uint16_t(lon_d),
+						.min = uint16_t(lon_m),
+						.decimal = uint32_t(lon_dec),
 					},
-				.londir = to_londir(*col),
+				.londir = lon_c == 'W' ? lon_dir::W : lon_dir::E,
 			},
+		.speed_kmh = int32_t(speed),
+		.heading = int32_t(heading),
+		.altitude_mm = int32_t(altitude),
+		.hdop = int32_t(hdop),
 	};
 }
@@ -1,7 +1,10 @@
 #pragma once
+#include <concepts>
 #include <cstdint>
 #include <limits>
 #include <numbers>
+#include <optional>
+#include <span>
 #include <string_view>
 
 constexpr auto to_degs_per_sec(int16_t gyr_point, float fullscale) {
@@ -23,28 +26,68 @@ struct DMM {
 	uint16_t deg;
 	uint16_t min;
 	uint32_t decimal;
-	constexpr auto to_deg() const {
-		return deg + (min + float(decimal) / 1'000'000.f) / 60.f;
+	template <std::floating_point T = double> constexpr auto to_deg() const {
+		return T(deg) + (T(min) + T(decimal) / T(1'000'000)) / T(60);
 	}
 };
 
-struct MercatorePos {
-	float x;
-	float y;
+// positions and their projection are templated on the scalar: float is
+// enough for the whole world at a glance, double is needed to look at
+// sub-meter details (float has ~7 digits, 1e-6 degrees is ~10 cm)
+template <std::floating_point T> struct basic_mercator_pos {
+	T x;
+	T y;
 };
 
-struct DegPos {
-	float lat;
-	float lon;
-	explicit operator MercatorePos() const;
+template <std::floating_point T> struct basic_deg_pos {
+	T lat;
+	T lon;
+	explicit operator basic_mercator_pos<T>() const;
 };
 
+using MercatorePos = basic_mercator_pos<double>;
+using DegPos = basic_deg_pos<double>;
+
+// MercatorePos(ps[i]) for a whole batch, vectorized (avx2 or generic
+// vectors, picked at runtime). within 1e-11 degrees of the scalar
+// conversion for |lat| <= 85, latitudes are clamped to +-89.9.
+// projects min(ps.size(), out.size()) positions
+void project(std::span<const DegPos> ps, std::span<MercatorePos> out);
+// name of the implementation in use, for logging
+auto project_impl() -> std::string_view;
+
 struct DMMPos {
 	DMM lat;
 	lat_dir latdir;
 	DMM lon;
 	lon_dir londir;
-	explicit operator DegPos() const;
+	template <std::floating_point T>
+	explicit operator basic_deg_pos<T>() const {
+		return {
+			.lat = T(latdir) * lat.to_deg<T>(),
+			.lon = T(londir) * lon.to_deg<T>(),
+		};
+	}
+};
+
+// meters east and north of an origin, on the plane tangent to the WGS84
+// ellipsoid there. close enough to the ground for the few kilometers of a
+// session, and with small coordinates that do not lose precision far from
+// the equator and the meridian
+struct enu_pos {
+	double east;
+	double north;
+};
+
+class local_tangent_plane {
+	DegPos origin_;
+	double sin_lat, cos_lat, sin_lon, cos_lon;
+	double ox, oy, oz; // origin in earth centered coordinates
+
+  public:
+	explicit local_tangent_plane(const DegPos &origin);
+	auto project(const DegPos &p) const -> enu_pos;
+	auto origin() const -> const DegPos & { return origin_; }
 };
 
 struct gps_hybrid {
@@ -52,8 +95,13 @@ struct gps_hybrid {
 	// 1460
 	uint32_t ts;
 	DMMPos pos;
+	int32_t speed_kmh;
+	int32_t heading;
+	int32_t altitude_mm;
+	int32_t hdop;
 };
 
-auto is_gps_hybrid(std::string_view sv) -> bool;
-
-auto to_gps_hybrid(std::string_view sv) -> gps_hybrid;
+// validates and decodes a "gpsrmc;..." line in one pass
+auto parse_gps_hybrid(std::string_view sv) -> std::optional<gps_hybrid>;
+// same, for the fields after a "gpsrmc;" tag already matched by the caller
+auto parse_gps_hybrid_fields(std::string_view sv) -> std::optional<gps_hybrid>;
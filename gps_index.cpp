@@ -0,0 +1,100 @@
+#include "gps_index.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+static auto key_of(int64_t cx, int64_t cy) {
+	return uint64_t(uint32_t(cx)) << 32 | uint32_t(cy);
+}
+
+void gps_index::add(const fix &f) {
+	const auto k = key_of(cell_of(f.x), cell_of(f.y));
+	cells[k].push_back(f);
+	order.push_back(k);
+	++fixes;
+}
+
+void gps_index::drop_before(double n) {
+	// the oldest fix overall is the front of the cell of the oldest entry
+	while (!order.empty()) {
+		// every entry of order has its cell, end() would be a bug
+		const auto it = cells.find(order.front());
+		if (it == cells.end() || it->second.front().n >= n) {
+			break;
+		}
+		it->second.pop_front();
+		if (it->second.empty()) {
+			cells.erase(it);
+		}
+		order.pop_front();
+		--fixes;
+	}
+}
+
+auto gps_index::in_order() const -> std::vector<fix> {
+	// the cells hold their fixes oldest first, order says which cell the
+	// next one is in
+	auto next = std::unordered_map<uint64_t, size_t>{};
+	auto out = std::vector<fix>{};
+	out.reserve(fixes);
+	for (const auto k : order) {
+		out.push_back(cells.at(k)[next[k]++]);
+	}
+	return out;
+}
+
+// calls f(fix) for the fixes of the cells touching box (a superset of the
+// fixes inside it). a box much larger than the occupied area walks the
+// occupied cells instead of every cell in the box
+template <typename F>
+void gps_index::visit(const gps_track::bbox &box, F &&f) const {
+	const auto x0 = cell_of(box.x0), x1 = cell_of(box.x1);
+	const auto y0 = cell_of(box.y0), y1 = cell_of(box.y1);
+	const auto span = double(x1 - x0 + 1) * double(y1 - y0 + 1);
+	if (span > double(cells.size())) {
+		for (const auto &[k, c] : cells) {
+			const auto cx = int64_t(int32_t(k >> 32));
+			const auto cy = int64_t(int32_t(k & 0xFFFF'FFFF));
+			if (cx >= x0 && cx <= x1 && cy >= y0 && cy <= y1) {
+				std::ranges::for_each(c, f);
+			}
+		}
+		return;
+	}
+	for (auto cx = x0; cx <= x1; ++cx) {
+		for (auto cy = y0; cy <= y1; ++cy) {
+			if (const auto it = cells.find(key_of(cx, cy)); it != cells.end()) {
+				std::ranges::for_each(it->second, f);
+			}
+		}
+	}
+}
+
+auto gps_index::nearest(double x, double y, double radius) const
+	-> std::optional<fix> {
+	auto best = std::optional<fix>{};
+	auto best_d = radius * radius;
+	visit({x - radius, y - radius, x + radius, y + radius},
+		  [&](const fix &f) {
+			  const auto d = (f.x - x) * (f.x - x) + (f.y - y) * (f.y - y);
+			  if (d <= best_d) {
+				  best_d = d;
+				  best = f;
+			  }
+		  });
+	return best;
+}
+
+auto gps_index::time_covered(const gps_track::bbox &box) const
+	-> std::optional<time_span> {
+	auto span = std::optional<time_span>{};
+	visit(box, [&](const fix &f) {
+		if (f.x < box.x0 || f.x > box.x1 || f.y < box.y0 || f.y > box.y1) {
+			return;
+		}
+		span = span ? time_span{std::min(span->from, f.t),
+								std::max(span->to, f.t)}
+					: time_span{f.t, f.t};
+	});
+	return span;
+}
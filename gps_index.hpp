@@ -0,0 +1,58 @@
+#pragma once
+#include "gps_track.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// interval on the host timeline (see time_base.hpp), in seconds
+struct time_span {
+	double from;
+	double to;
+};
+
+// uniform grid over the projected fixes, for picking the fix under the
+// mouse and selecting the fixes in a rectangle. every fix carries its time
+// on the timeline the imu plots use, which links the map to them.
+// fixes are added and evicted in order, as they are by gps_track
+class gps_index {
+  public:
+	struct fix {
+		double x, y; // projected
+		double n;	 // index of the fix, as in gps_track
+		DegPos pos;
+		double t; // host timeline, from the utc time of the fix
+	};
+
+	// side of a cell in projected units: about 10 m gives a few fixes per
+	// cell at walking speed and 1 Hz
+	explicit gps_index(double cell_size = 1e-4) : cell{cell_size} {}
+
+	void add(const fix &f);
+	// forgets the fixes with an index lower than n
+	void drop_before(double n);
+
+	// the closest fix within radius of (x, y)
+	auto nearest(double x, double y, double radius) const
+		-> std::optional<fix>;
+	// the time covered by the fixes inside box
+	auto time_covered(const gps_track::bbox &box) const
+		-> std::optional<time_span>;
+
+	auto size() const { return fixes; }
+	// every fix, oldest first
+	auto in_order() const -> std::vector<fix>;
+
+  private:
+	auto cell_of(double v) const { return int64_t(std::floor(v / cell)); }
+	template <typename F> void visit(const gps_track::bbox &box, F &&f) const;
+
+	double cell;
+	std::unordered_map<uint64_t, std::deque<fix>> cells{};
+	std::deque<uint64_t> order{}; // cell of every fix, oldest first
+	size_t fixes = 0;
+};
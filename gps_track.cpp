@@ -0,0 +1,96 @@
+#include "gps_track.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// about 20 cm at the finest level, 50 km at the coarsest
+constexpr auto base_cell_m = 0.2;
+constexpr auto cell_factor = 4.;
+
+auto gps_track::meter() const -> double {
+	// a degree of longitude at the equator is 111.32 km
+	return mode == projection::local ? 1. : 1. / 111'319.49;
+}
+
+auto gps_track::cell_size(size_t l) const -> double {
+	return base_cell_m * meter() * std::pow(cell_factor, double(l - 1));
+}
+
+auto gps_track::pick(double units_per_pixel) const -> size_t {
+	auto l = size_t{0};
+	while (l + 1 < levels && cell_size(l + 1) <= units_per_pixel) {
+		++l;
+	}
+	return l;
+}
+
+void gps_track::project_all(std::span<const DegPos> ps) {
+	projected.resize(ps.size());
+	if (mode == projection::mercator) {
+		project(ps, projected);
+		return;
+	}
+	if (!plane && !ps.empty()) {
+		plane.emplace(ps.front());
+	}
+	std::ranges::transform(ps, projected.begin(), [&](const DegPos &p) {
+		const auto e = plane->project(p);
+		return MercatorePos{e.east, e.north};
+	});
+}
+
+auto gps_track::store(const DegPos &p, const MercatorePos &m)
+	-> std::optional<level::row> {
+	if (last_fix && last_fix->lat == p.lat && last_fix->lon == p.lon) {
+		return {};
+	}
+	last_fix = p;
+	const auto r = level::row{m.x, m.y, fixes++};
+
+	add(0, r, false);
+	for (auto l = size_t{1}; l < levels; ++l) {
+		const auto c = std::pair{int64_t(std::floor(r[x] / cell_size(l))),
+								 int64_t(std::floor(r[y] / cell_size(l)))};
+		const auto same = !lv[l].empty() && anchor[l] == c;
+		anchor[l] = c;
+		add(l, r, same);
+	}
+	return r;
+}
+
+void gps_track::add(size_t l, const level::row &r, bool replace) {
+	auto &pages = lv[l];
+	const auto before = pages.pages().size();
+	if (replace) {
+		pages.replace_back(r);
+	} else {
+		pages.push(r);
+	}
+
+	auto &boxes = bb[l];
+	if (pages.pages().size() != before) {
+		// a new page, which starts with the last row of the previous one
+		const auto &first = pages.pages().back();
+		boxes.push_back({first.front(x), first.front(y), first.front(x),
+						 first.front(y)});
+	}
+	auto &b = boxes.back();
+	b.x0 = std::min(b.x0, r[x]);
+	b.y0 = std::min(b.y0, r[y]);
+	b.x1 = std::max(b.x1, r[x]);
+	b.y1 = std::max(b.y1, r[y]);
+}
+
+void gps_track::trim() {
+	if (empty()) {
+		return;
+	}
+	lv[0].trim(keep);
+	const auto oldest = lv[0].front(n);
+	for (auto l = size_t{0}; l < levels; ++l) {
+		lv[l].drop_before(oldest, n);
+		while (bb[l].size() > lv[l].pages().size()) {
+			bb[l].pop_front();
+		}
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "gps.hpp"
+#include "paged_columns.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+// projected gps track with a level of detail pyramid for drawing it.
+// fixes are projected once as they arrive, a batch at a time and in double
+// precision, on mercator or on the plane tangent to the first fix (a
+// repeated fix, the receiver standing still, is not stored again).
+// level 0 holds every point, level l keeps one point per grid cell of
+// cell_size(l) entered by the track, the last one seen in it. every page of
+// every level has its bounding box, so pages out of view are skipped
+// without looking at them
+class gps_track {
+  public:
+	enum column : size_t { x, y, n, count }; // n: index of the fix
+	using level = paged_columns<double, count>;
+	struct bbox {
+		double x0, y0, x1, y1;
+		auto overlaps(const bbox &o) const {
+			return x0 <= o.x1 && o.x0 <= x1 && y0 <= o.y1 && o.y0 <= y1;
+		}
+	};
+
+	static constexpr auto levels = size_t{10};
+
+	// mercator: degrees of longitude and mercator degrees of latitude.
+	// local: meters east and north of the first fix
+	enum class projection { mercator, local };
+
+	gps_track() : gps_track(projection::mercator) {}
+	explicit gps_track(projection p) : mode{p} {}
+
+	retention keep{.bytes = size_t{64} << 20};
+
+	// projects a batch of fixes in one go and stores them, calling
+	// stored(fix, row) for every fix that does not repeat the one before
+	template <typename F> void push(std::span<const DegPos> ps, F &&stored) {
+		project_all(ps);
+		for (auto i = size_t{0}; i < ps.size(); ++i) {
+			if (const auto r = store(ps[i], projected[i])) {
+				stored(ps[i], *r);
+			}
+		}
+	}
+	// applies keep to level 0, the other levels follow it
+	void trim();
+
+	auto at(size_t l) const -> const level & { return lv[l]; }
+	auto boxes(size_t l) const -> const std::deque<bbox> & { return bb[l]; }
+	auto empty() const { return lv[0].empty(); }
+	auto size() const { return lv[0].size(); }
+	auto projected_on() const { return mode; }
+
+	// a meter on the ground in projected units (at the equator on mercator)
+	auto meter() const -> double;
+	// side of the grid of level l, in projected units
+	auto cell_size(size_t l) const -> double;
+	// the coarsest level whose cells are no bigger than a pixel
+	auto pick(double units_per_pixel) const -> size_t;
+
+  private:
+	void project_all(std::span<const DegPos> ps);
+	auto store(const DegPos &p, const MercatorePos &m)
+		-> std::optional<level::row>;
+	void add(size_t l, const level::row &r, bool replace);
+
+	projection mode;
+	std::optional<local_tangent_plane> plane{};
+	std::vector<MercatorePos> projected{}; // scratch, x y of either projection
+
+	std::array<level, levels> lv{};
+	std::array<std::deque<bbox>, levels> bb{};
+	std::array<std::pair<int64_t, int64_t>, levels> anchor{};
+	std::optional<DegPos> last_fix{};
+	double fixes = 0;
+};
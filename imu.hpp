@@ -2,6 +2,7 @@
 
 #include <array>
 #include <cstdint>
+#include <optional>
 #include <string_view>
 
 struct imu {
@@ -10,6 +11,7 @@ struct imu {
 	std::array<int16_t, 3> gyro{};
 };
 
-auto is_imu(std::string_view sv) -> bool;
-
-auto to_imu(std::string_view sv) -> imu;
+// validates and decodes an "imu;ts;ax;ay;az;gx;gy;gz" line in one pass
+auto parse_imu(std::string_view sv) -> std::optional<imu>;
+// same, for the fields after a "imu;" tag already matched by the caller
+auto parse_imu_fields(std::string_view sv) -> std::optional<imu>;
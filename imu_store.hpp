@@ -0,0 +1,43 @@
+#pragma once
+#include "imu.hpp"
+#include "minmax_lod.hpp"
+#include "paged_columns.hpp"
+
+#include <array>
+#include <cstddef>
+
+// columnar imu history: one timestamp column shared by every trace and one
+// contiguous float column per axis per sensor, ready to be handed to ImPlot
+// (or to a filter) as plain arrays, one page at a time
+struct imu_columns {
+	enum column : size_t { ts, ax, ay, az, gx, gy, gz, count };
+	static constexpr auto acc = std::array<size_t, 3>{ax, ay, az};
+	static constexpr auto gyro = std::array<size_t, 3>{gx, gy, gz};
+
+	paged_columns<float, count> history{};
+	// channels in column order without ts: channel c is column c + 1
+	minmax_lod<count - 1> lod{};
+	retention keep{.seconds = 15 * 60};
+
+	// t on the host timeline, s (see device_clock)
+	void push(const imu &s, double t_host) {
+		const auto t = float(t_host);
+		const auto v = minmax_lod<count - 1>::values{
+			float(s.acc[0]),  float(s.acc[1]),	float(s.acc[2]),
+			float(s.gyro[0]), float(s.gyro[1]), float(s.gyro[2])};
+		history.push({t, v[0], v[1], v[2], v[3], v[4], v[5]});
+		lod.push(t, v);
+	}
+	// applies keep, once per batch of pushes is enough
+	void trim() {
+		history.trim(keep, ts);
+		if (!history.empty()) {
+			lod.drop_before(history.front(ts));
+		}
+	}
+
+	auto size() const { return history.size(); }
+	auto empty() const { return history.empty(); }
+	auto first_ts() const { return empty() ? 0. : double(history.front(ts)); }
+	auto last_ts() const { return empty() ? 0. : double(history.back(ts)); }
+};
@@ -0,0 +1,106 @@
+#include "io_reactor.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <span>
+#include <system_error>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+static auto check(int ret, const char *what) -> int {
+	if (ret < 0) {
+		throw std::system_error(errno, std::system_category(), what);
+	}
+	return ret;
+}
+
+io_reactor::unique_fd::~unique_fd() {
+	if (fd >= 0) {
+		close(fd);
+	}
+}
+
+io_reactor::io_reactor()
+	: ep{check(epoll_create1(EPOLL_CLOEXEC), "epoll_create1")},
+	  wakeup{check(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK), "eventfd")} {
+	auto ev = epoll_event{.events = EPOLLIN, .data = {.fd = wakeup.fd}};
+	check(epoll_ctl(ep.fd, EPOLL_CTL_ADD, wakeup.fd, &ev), "epoll_ctl");
+	// started once there is a way to stop it
+	thread = std::jthread{[this](std::stop_token stop) { loop(stop); }};
+}
+
+io_reactor::~io_reactor() {
+	thread.request_stop();
+	wake();
+}
+
+void io_reactor::watch(int fd, handler h) {
+	auto lock = std::lock_guard{m};
+	handlers.insert_or_assign(fd, std::move(h));
+	auto ev = epoll_event{.events = EPOLLIN, .data = {.fd = fd}};
+	if (epoll_ctl(ep.fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		const auto err = errno;
+		handlers.erase(fd);
+		throw std::system_error(err, std::system_category(), "epoll_ctl");
+	}
+}
+
+void io_reactor::unwatch(int fd) {
+	auto lock = std::lock_guard{m};
+	forget(fd);
+}
+
+auto io_reactor::watched() const -> size_t {
+	auto lock = std::lock_guard{m};
+	return handlers.size();
+}
+
+void io_reactor::wake() {
+	const auto one = uint64_t{1};
+	// can only fail if the counter is about to overflow: already awake
+	(void)!write(wakeup.fd, &one, sizeof(one));
+}
+
+void io_reactor::forget(int fd) {
+	if (handlers.erase(fd) > 0) {
+		epoll_ctl(ep.fd, EPOLL_CTL_DEL, fd, nullptr);
+	}
+}
+
+void io_reactor::loop(std::stop_token stop) {
+	auto events = std::array<epoll_event, 64>{};
+	while (!stop.stop_requested()) {
+		const auto n = epoll_wait(ep.fd, events.data(), int(events.size()), -1);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			spdlog::error("io reactor stopped: epoll_wait errno {}", errno);
+			return;
+		}
+
+		auto lock = std::lock_guard{m};
+		for (const auto &ev : std::span(events).first(size_t(n))) {
+			const auto fd = ev.data.fd;
+			if (fd == wakeup.fd) {
+				auto count = uint64_t{};
+				(void)!read(wakeup.fd, &count, sizeof(count));
+				continue;
+			}
+			// unwatched while this batch was waiting for the lock
+			const auto h = handlers.find(fd);
+			if (h == handlers.end()) {
+				continue;
+			}
+			const auto hangup = (ev.events & (EPOLLHUP | EPOLLERR)) != 0;
+			if (!h->second(hangup) || hangup) {
+				forget(fd);
+			}
+		}
+	}
+}
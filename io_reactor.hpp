@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// one thread waiting with epoll on the file descriptors of every open port:
+// it sleeps until one of them has data and then calls the handler of that
+// port, which reads everything ready in large chunks. idle ports cost
+// nothing, and dozens of them share the thread. linux only, elsewhere every
+// port has a reader thread of its own
+class io_reactor {
+  public:
+	// called on the reactor thread when fd is readable, or with hangup set
+	// when the other end went away or the fd failed. returns whether to keep
+	// watching fd, after a hangup it is dropped anyway.
+	// handlers must not call watch() or unwatch()
+	using handler = std::function<bool(bool hangup)>;
+
+	io_reactor();
+	~io_reactor();
+	io_reactor(const io_reactor &) = delete;
+	auto operator=(const io_reactor &) -> io_reactor & = delete;
+
+	void watch(int fd, handler h);
+	// once this returns the handler of fd is not running and never will
+	void unwatch(int fd);
+	auto watched() const -> size_t;
+
+  private:
+	// closes on destruction
+	struct unique_fd {
+		int fd;
+		explicit unique_fd(int f) : fd{f} {}
+		unique_fd(const unique_fd &) = delete;
+		auto operator=(const unique_fd &) -> unique_fd & = delete;
+		~unique_fd();
+	};
+
+	void loop(std::stop_token stop);
+	void wake();
+	void forget(int fd);
+
+	unique_fd ep;
+	unique_fd wakeup; // eventfd, makes epoll_wait return to stop the loop
+	// held while a handler runs, that is what unwatch() waits for
+	mutable std::mutex m{};
+	std::unordered_map<int, handler> handlers{};
+	// declared last: joined before the descriptors are closed
+	std::jthread thread{};
+};
@@ -1,4 +1,5 @@
 #include "leo_widgets.hpp"
+#include <algorithm>
 #include <cmath>
 #include <numbers>
 
@@ -66,9 +67,9 @@ auto plotline(std::span<const T> data, const plot_trace<G> &trace) {
 					  int(data.size()));
 }
 
-template <typename T, typename... TR>
+template <typename F>
 void show_lplot(l_plot &plot_data, const char *yunits, double time,
-				std::span<const T> data, TR... traces) {
+				F &&plot_traces) {
 	ImGui::SetNextWindowSize(ImVec2(600, 600), ImGuiCond_FirstUseEver);
 	ImGui::Checkbox("lock##hist", &plot_data.history_limited);
 	if (plot_data.history_limited) {
@@ -82,7 +83,12 @@ void show_lplot(l_plot &plot_data, const char *yunits, double time,
 		ImGui::SliderFloat("Scale", &plot_data.yscale, 1,
 						   std::numeric_limits<int16_t>::max(), "%.1f");
 	}
-	if (plot_data.history_limited) {
+	if (plot_data.focus_span) {
+		// half a second around it, a single fix is a single instant
+		const auto s = *plot_data.focus_span;
+		ImPlot::SetNextPlotLimitsX(s.from - 0.5, s.to + 0.5, ImGuiCond_Always);
+		plot_data.focus_span.reset();
+	} else if (plot_data.history_limited) {
 		ImPlot::SetNextPlotLimitsX(time - double(plot_data.history), time,
 								   ImGuiCond_Always);
 	}
@@ -93,29 +99,117 @@ void show_lplot(l_plot &plot_data, const char *yunits, double time,
 								   ImGuiCond_Always);
 	}
 	if (ImPlot::BeginPlot("", "s", yunits, ImVec2(-1, 400))) {
-		(plotline(data, traces), ...);
+		plot_traces();
 		ImPlot::EndPlot();
 	}
 }
 
-static auto last_ts(std::span<const imu> data) {
-	if (data.size() > 0) {
-		return data.back().ts / 1000.;
+// the samples inside the x limits of the current plot, plus one on each side
+static auto visible_samples(std::span<const imu> data)
+	-> std::span<const imu> {
+	const auto lim = ImPlot::GetPlotLimits().X;
+	const auto ts = [](const imu &im) { return im.ts / 1000.; };
+	const auto lo = std::ranges::lower_bound(data, lim.Min, {}, ts);
+	const auto hi = std::ranges::upper_bound(data, lim.Max, {}, ts);
+	const auto first = size_t(std::max(lo - data.begin(), ptrdiff_t{1}) - 1);
+	const auto last = std::min(size_t(hi - data.begin()) + 1, data.size());
+	return first < last ? data.subspan(first, last - first)
+						: std::span<const imu>{};
+}
+
+template <typename... TR>
+void show_lplot(l_plot &plot_data, const char *yunits, double time,
+				std::span<const imu> data, TR... traces) {
+	show_lplot(plot_data, yunits, time, [&] {
+		const auto shown = visible_samples(data);
+		(plotline(shown, traces), ...);
+	});
+}
+
+using imu_lod = decltype(imu_columns::lod);
+
+// rows [first, last) of a page whose time is in [x0, x1], plus one row of
+// margin on each side so the lines reach the edges of the plot. timestamps
+// are monotonic, so this is two binary searches
+struct row_window {
+	size_t first;
+	size_t last;
+	auto size() const { return last - first; }
+};
+
+static auto visible_rows(const std::vector<float> &t, double x0, double x1)
+	-> row_window {
+	if (t.empty() || double(t.back()) < x0 || double(t.front()) > x1) {
+		return {0, 0};
 	}
-	return 0.;
+	const auto before = [](float v, double x) { return double(v) < x; };
+	const auto after = [](double x, float v) { return x < double(v); };
+	const auto lo = std::lower_bound(t.begin(), t.end(), x0, before);
+	const auto hi = std::upper_bound(t.begin(), t.end(), x1, after);
+	const auto first = size_t(lo - t.begin());
+	const auto last = size_t(hi - t.begin());
+	return {first > 0 ? first - 1 : 0, std::min(last + 1, t.size())};
 }
-static auto last_ts(std::span<const acc_plot::sample> data) {
-	if (data.size() > 0) {
-		return float(data.back().ts);
+
+// one channel of the visible rows of a page of a lod level, drawn as lo,
+// hi of every bucket
+struct lod_trace {
+	const imu_lod::level::page *p;
+	size_t ch;
+	size_t first;
+};
+
+static auto lod_point(void *data, int idx) -> ImPlotPoint {
+	const auto &tr = *static_cast<const lod_trace *>(data);
+	const auto row = tr.first + size_t(idx / 2);
+	const auto col = idx % 2 ? imu_lod::hi(tr.ch) : imu_lod::lo(tr.ch);
+	return {double(tr.p->cols[0][row]), double(tr.p->cols[col][row])};
+}
+
+// the three axes of a sensor, straight from the columns or from the lod
+// level that gives about two points per pixel over the visible time span.
+// only the rows inside the x limits are handed to ImPlot, and pages are
+// drawn one by one under the same label so they show up as a single trace
+static void plot_axes(const imu_columns &data,
+					  const std::array<size_t, 3> &axes) {
+	constexpr auto names = std::array{"x", "y", "z"};
+
+	const auto lim = ImPlot::GetPlotLimits().X;
+	const auto &raw = data.history.pages();
+	auto visible = size_t{0};
+	for (const auto &p : raw) {
+		const auto &t = p.cols[imu_columns::ts];
+		visible += visible_rows(t, lim.Min, lim.Max).size();
+	}
+	const auto width = std::max(ImPlot::GetPlotSize().x, 1.f);
+	const auto level = imu_lod::pick(visible, 2 * size_t(width));
+
+	if (level == 0) {
+		for (const auto &p : raw) {
+			const auto &t = p.cols[imu_columns::ts];
+			const auto w = visible_rows(t, lim.Min, lim.Max);
+			for (auto i = 0u; w.size() > 0 && i < axes.size(); ++i) {
+				ImPlot::PlotLine(names[i], t.data() + w.first,
+								 p.cols[axes[i]].data() + w.first,
+								 int(w.size()));
+			}
+		}
+		return;
+	}
+	for (const auto &p : data.lod.at(level).pages()) {
+		const auto w = visible_rows(p.cols[0], lim.Min, lim.Max);
+		for (auto i = 0u; w.size() > 0 && i < axes.size(); ++i) {
+			auto tr = lod_trace{&p, axes[i] - 1, w.first};
+			ImPlot::PlotLineG(names[i], lod_point, &tr, int(2 * w.size()));
+		}
 	}
-	return 0.f;
 }
 
-static auto last_ts(std::span<const gyro_plot::sample> data) {
+static auto last_ts(std::span<const imu> data) {
 	if (data.size() > 0) {
-		return float(data.back().ts);
+		return data.back().ts / 1000.;
 	}
-	return 0.f;
+	return 0.;
 }
 
 void gyro_plot::show(std::span<const imu> data, std::span<const float, 3> dir) {
@@ -136,36 +230,19 @@ void gyro_plot::show(std::span<const imu> data, std::span<const float, 3> dir) {
 						  })));
 }
 
-void gyro_plot::show(std::span<const sample> data,
-					 std::span<const float, 3> dir) {
+void gyro_plot::show(const imu_columns &data, std::span<const float, 3> dir) {
 	plot_direction("x", dir[0]);
 	ImGui::SameLine();
 	plot_direction("y", dir[1]);
 	ImGui::SameLine();
 	plot_direction("z", dir[2]);
-	show_lplot(plt, "nesi", last_ts(data), data,
-			   make_trace("x", getter([](const sample &im) {
-							  return ImPlotPoint{im.ts, im.values[0]};
-						  })),
-			   make_trace("y", getter([](const sample &im) {
-							  return ImPlotPoint{im.ts, im.values[1]};
-						  })),
-			   make_trace("z", getter([](const sample &im) {
-							  return ImPlotPoint{im.ts, im.values[2]};
-						  })));
+	show_lplot(plt, "nesi", data.last_ts(),
+			   [&] { plot_axes(data, imu_columns::gyro); });
 }
 
-void acc_plot::show(std::span<const sample> d) {
-	show_lplot(plt, "leandri", last_ts(d), d,
-			   make_trace("x", getter([](const acc_plot::sample &dt) {
-							  return ImPlotPoint{dt.ts, dt.values[0]};
-						  })),
-			   make_trace("y", getter([](const acc_plot::sample &dt) {
-							  return ImPlotPoint{dt.ts, dt.values[1]};
-						  })),
-			   make_trace("z", getter([](const acc_plot::sample &dt) {
-							  return ImPlotPoint{dt.ts, dt.values[2]};
-						  })));
+void acc_plot::show(const imu_columns &data) {
+	show_lplot(plt, "leandri", data.last_ts(),
+			   [&] { plot_axes(data, imu_columns::acc); });
 }
 
 void acc_plot::show(std::span<const imu> data) {
@@ -180,3 +257,65 @@ void acc_plot::show(std::span<const imu> data) {
 							  return ImPlotPoint(im.ts / 1000., im.acc[2]);
 						  })));
 }
+
+// draws the track inside the current plot, at the level of detail that
+// matches the zoom and only the pages in view
+static void plot_track(const char *label, const gps_track &track) {
+	const auto lim = ImPlot::GetPlotLimits();
+	const auto view =
+		gps_track::bbox{lim.X.Min, lim.Y.Min, lim.X.Max, lim.Y.Max};
+	const auto width = std::max(ImPlot::GetPlotSize().x, 1.f);
+	const auto level = track.pick(lim.X.Size() / double(width));
+
+	const auto &pages = track.at(level).pages();
+	const auto &boxes = track.boxes(level);
+	for (auto i = size_t{0}; i < pages.size(); ++i) {
+		if (!boxes[i].overlaps(view)) {
+			continue;
+		}
+		const auto &p = pages[i];
+		ImPlot::PlotLine(label, p.cols[gps_track::x].data(),
+						 p.cols[gps_track::y].data(), int(p.size()));
+	}
+}
+
+auto track_plot::show(const gps_track &track, const gps_index &fixes)
+	-> std::optional<time_span> {
+	auto changed = std::optional<time_span>{};
+	const auto local = track.projected_on() == gps_track::projection::local;
+	if (!ImPlot::BeginPlot(local ? "pos - local" : "pos - mercatore",
+						   local ? "east (m)" : "longitude",
+						   local ? "north (m)" : "latitude", ImVec2(800, 800),
+						   ImPlotFlags_Query)) {
+		return changed;
+	}
+	plot_track("trace", track);
+
+	if (ImPlot::IsPlotHovered()) {
+		const auto width = std::max(ImPlot::GetPlotSize().x, 1.f);
+		const auto per_px = ImPlot::GetPlotLimits().X.Size() / double(width);
+		const auto m = ImPlot::GetPlotMousePos();
+		if (const auto f = fixes.nearest(m.x, m.y, 8 * per_px)) {
+			ImPlot::PlotScatter("fix", &f->x, &f->y, 1);
+			ImGui::BeginTooltip();
+			ImGui::Text("fix %.0f\n%.6f %.6f\nimu t %.3f s", f->n,
+						double(f->pos.lat), double(f->pos.lon), f->t);
+			ImGui::EndTooltip();
+		}
+	}
+
+	if (ImPlot::IsPlotQueried()) {
+		const auto q = ImPlot::GetPlotQuery();
+		const auto span =
+			fixes.time_covered({q.X.Min, q.Y.Min, q.X.Max, q.Y.Max});
+		if (span && (!selected || span->from != selected->from ||
+					 span->to != selected->to)) {
+			changed = span;
+		}
+		selected = span;
+	} else {
+		selected.reset();
+	}
+	ImPlot::EndPlot();
+	return changed;
+}
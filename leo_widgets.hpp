@@ -1,7 +1,11 @@
 #pragma once
+#include "gps_index.hpp"
+#include "gps_track.hpp"
 #include "imu.hpp"
+#include "imu_store.hpp"
 #include <functional>
 #include <limits>
+#include <optional>
 #include <span>
 
 template <typename T> struct decompose;
@@ -23,24 +27,31 @@ struct l_plot {
 	bool history_limited = true;
 	float yscale = float(std::numeric_limits<int16_t>::max());
 	bool scale_limited = true;
+	std::optional<time_span> focus_span{};
+	// shows exactly this span on the next frame, unlocking the history
+	void focus(const time_span &s) {
+		focus_span = s;
+		history_limited = false;
+	}
 };
 
 struct gyro_plot {
-	struct sample {
-		float ts;
-		std::array<float, 3> values;
-	};
 	l_plot plt{};
 	void show(std::span<const imu> data, std::span<const float, 3> dir);
-	void show(std::span<const sample> data, std::span<const float, 3> dir);
+	void show(const imu_columns &data, std::span<const float, 3> dir);
 };
 
 struct acc_plot {
-	struct sample {
-		float ts;
-		std::array<float, 3> values;
-	};
 	l_plot plt{};
 	void show(std::span<const imu> data);
-	void show(std::span<const sample> d);
+	void show(const imu_columns &data);
+};
+
+struct track_plot {
+	std::optional<time_span> selected{};
+	// the track, a tooltip for the fix under the mouse and a query
+	// rectangle selecting fixes. returns the imu time span of the
+	// selection when it changes
+	auto show(const gps_track &track, const gps_index &fixes)
+		-> std::optional<time_span>;
 };
@@ -0,0 +1,55 @@
+#include "line_buffer.hpp"
+#include "delim_scan.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+auto line_buffer::writable(size_t min_free) -> std::span<char> {
+	if (storage.size() - end < min_free && begin > 0) {
+		// only the unterminated tail (or the lines left over by a budgeted
+		// drain) is moved, not the whole history
+		std::memmove(storage.data(), storage.data() + begin, end - begin);
+		scanned -= begin;
+		end -= begin;
+		begin = 0;
+		// the cached mask describes the bytes where they were before the
+		// move: the next line scans its block again
+		mask_base = mask_end = scanned;
+	}
+	if (end == storage.size()) {
+		// a single line bigger than the whole buffer: it is garbage anyway
+		discarded_ += end - begin;
+		rewind();
+	}
+	return std::span(storage).subspan(end);
+}
+
+auto line_buffer::next_line() -> std::optional<std::string_view> {
+	while (scanned < end) {
+		if (scanned >= mask_end) {
+			const auto len = std::min(delim_block, end - scanned);
+			nl_mask = scan_delims(std::span(storage).subspan(scanned, len))
+						  .newline;
+			mask_base = scanned;
+			mask_end = scanned + len;
+		}
+		const auto pending = nl_mask >> (scanned - mask_base);
+		if (pending == 0) {
+			scanned = mask_end;
+			continue;
+		}
+
+		const auto nl_pos = scanned + size_t(std::countr_zero(pending));
+		const auto line =
+			std::string_view(storage.data() + begin, nl_pos - begin);
+		begin = scanned = nl_pos + 1;
+		return line;
+	}
+
+	if (begin == end) {
+		// everything consumed, rewinding is free
+		rewind();
+	}
+	return {};
+}
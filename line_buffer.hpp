@@ -0,0 +1,57 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// fixed capacity receive buffer for a line based protocol.
+// bytes are read straight into the free tail (writable() + commit()) and
+// complete lines are handed out as views into the storage, without copies
+// or allocations. newlines are located 64 bytes at a time with scan_delims.
+// the consumed head is reclaimed only when the tail runs out of room, by
+// moving the few unconsumed bytes back to the start.
+// views returned by next_line() stay valid until the next writable()
+class line_buffer {
+	std::vector<char> storage;
+	size_t begin = 0;	// first unconsumed byte
+	size_t scanned = 0; // bytes in [begin, scanned) contain no '\n'
+	size_t end = 0;		// one past the last received byte
+	size_t discarded_ = 0;
+	// newline bitmask of the block [mask_base, mask_end), from scan_delims
+	size_t mask_base = 0;
+	size_t mask_end = 0;
+	uint64_t nl_mask = 0;
+
+	void rewind() { begin = scanned = end = mask_base = mask_end = 0; }
+
+  public:
+	static constexpr auto default_capacity = size_t{64 * 1024};
+
+	explicit line_buffer(size_t capacity = default_capacity)
+		: storage(capacity) {}
+
+	// free space at the tail, at least min_free bytes if that is possible
+	auto writable(size_t min_free) -> std::span<char>;
+	// marks n bytes of the last writable() span as received
+	void commit(size_t n) { end += n; }
+
+	auto next_line() -> std::optional<std::string_view>;
+
+	// raw access for the binary protocol: the received but unconsumed
+	// bytes, and how many of them have been used
+	auto unconsumed() const -> std::span<const char> {
+		return std::span(storage).subspan(begin, end - begin);
+	}
+	void consume(size_t n) {
+		begin += n;
+		scanned = std::max(scanned, begin);
+	}
+
+	auto size() const -> size_t { return end - begin; }
+	auto capacity() const -> size_t { return storage.size(); }
+	// bytes thrown away because a line did not fit in the whole buffer
+	auto discarded() const -> size_t { return discarded_; }
+};
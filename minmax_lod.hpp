@@ -0,0 +1,93 @@
+#pragma once
+#include "paged_columns.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+// min/max decimation pyramid of a set of channels sharing a time column.
+// level l (1 to levels) has one row per factor^l samples: the time of the
+// first sample of the bucket, then min and max of every channel over it.
+// every level is updated on each push, the last row of a level is the
+// bucket being filled, so the coarse views are never behind the data
+template <size_t Channels> class minmax_lod {
+  public:
+	static constexpr auto factor = size_t{8};
+	static constexpr auto levels = size_t{6};
+	static constexpr auto columns = 1 + 2 * Channels;
+	using level = paged_columns<float, columns>;
+	using values = std::array<float, Channels>;
+
+	static constexpr auto lo(size_t ch) { return 1 + 2 * ch; }
+	static constexpr auto hi(size_t ch) { return 2 + 2 * ch; }
+	// samples summarized by one row of level l
+	static constexpr auto bucket(size_t l) {
+		auto n = size_t{1};
+		for (auto i = size_t{0}; i < l; ++i) {
+			n *= factor;
+		}
+		return n;
+	}
+
+	minmax_lod() {
+		for (auto &l : lv) {
+			l = level{level_page_rows};
+		}
+	}
+
+	void push(float t, const values &v) {
+		for (auto l = size_t{0}; l < levels; ++l) {
+			if (filled[l] == 0) {
+				auto r = typename level::row{};
+				r[0] = t;
+				for (auto ch = size_t{0}; ch < Channels; ++ch) {
+					r[lo(ch)] = r[hi(ch)] = v[ch];
+				}
+				lv[l].push(r);
+			} else {
+				auto r = lv[l].back_row();
+				for (auto ch = size_t{0}; ch < Channels; ++ch) {
+					r[lo(ch)] = std::min(r[lo(ch)], v[ch]);
+					r[hi(ch)] = std::max(r[hi(ch)], v[ch]);
+				}
+				lv[l].replace_back(r);
+			}
+			if (++filled[l] == bucket(l + 1)) {
+				filled[l] = 0;
+			}
+		}
+	}
+
+	// l from 1 to levels
+	auto at(size_t l) const -> const level & { return lv[l - 1]; }
+
+	// the finest level that draws a span of n samples with at most
+	// max_points points (two per row), the coarsest one if none does
+	static auto pick(size_t n, size_t max_points) -> size_t {
+		auto l = size_t{0};
+		while (l < levels && (l == 0 ? n : 2 * (n / bucket(l))) > max_points) {
+			++l;
+		}
+		return l;
+	}
+
+	// follows the eviction of the raw samples
+	void drop_before(float oldest) {
+		for (auto &l : lv) {
+			l.drop_before(oldest);
+		}
+	}
+
+	void clear() {
+		for (auto &l : lv) {
+			l.clear();
+		}
+		filled = {};
+	}
+
+  private:
+	static constexpr auto level_page_rows = size_t{1024};
+
+	std::array<level, levels> lv{};
+	std::array<size_t, levels> filled{}; // samples in the last row
+};
@@ -1,5 +1,6 @@
 #include "mock_device.hpp"
-#include <numbers>
+#include <algorithm>
+#include <cmath>
 #include <span>
 #include <thread>
 
@@ -62,19 +63,14 @@ void mock_imu::update() {
 		return back;
 	};
 
+	const auto now = host_us();
 	for (auto sam = 0; sam < to_add; ++sam) {
-		imu_samples.emplace_back(new_data_gen());
-
-		const auto &gyr = imu_samples.back().gyro;
-		const auto dt =
-			(imu_samples.back().ts - (imu_samples.end() - 2)->ts) / 1000.f;
-		for (auto i = 0u; i < gyr.size(); ++i) {
-			imu_direction[i] = std::remainder(
-				imu_direction[i] +
-					to_radians(to_increment(to_degs_per_sec(gyr[i], 245), dt)),
-				std::numbers::pi_v<float>);
-		}
+		const auto &s = imu_samples.emplace_back(new_data_gen());
+		const auto t = clock.tick(s.ts, now);
+		attitude.update(s, t.dt);
+		imu_times.push_back(t.t);
 	}
+	imu_direction = to_turns(attitude.euler());
 
 	last = imu_samples.back();
 }
@@ -99,10 +95,12 @@ void mock_gps::update() {
 	}
 
 	generated += to_add;
+	const auto now = double(host_us()) / 1e6;
 	for (auto i = 0; i < to_add; ++i) {
 		last.lat += random_acc(random_engine);
 		last.lon += random_acc(random_engine);
 		update_bb(gps_boundingbox, last);
 		gps_samples.emplace_back(last);
+		gps_times.push_back(now);
 	}
 }
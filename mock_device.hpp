@@ -1,6 +1,8 @@
 #pragma once
+#include "attitude.hpp"
 #include "gps.hpp"
 #include "imu.hpp"
+#include "time_base.hpp"
 #include <cstdint>
 #include <random>
 #include <vector>
@@ -24,6 +26,7 @@ struct mock_imu {
 	imu last{};
 	size_t generated{0};
 	std::vector<imu> imu_samples{};
+	std::vector<double> imu_times{};
 
 	std::default_random_engine random_engine{std::random_device{}()};
 	std::uniform_int_distribution<int> random_acc{-2, 2};
@@ -33,29 +36,37 @@ struct mock_imu {
 	std::pair<std::array<int16_t, 3>, std::array<int16_t, 3>> attractor{};
 	lclock attractor_clock{};
 
+	// roll, pitch, yaw in turns
 	std::array<float, 3> imu_direction{};
+	attitude_filter attitude{};
+	device_clock clock{};
 
 	void update();
 };
 
-constexpr auto office = DegPos{41.9134432f, 12.5010377f};
+constexpr auto office = DegPos{41.9134432, 12.5010377};
 struct mock_gps {
 	std::default_random_engine random_engine{std::random_device{}()};
-	std::uniform_real_distribution<float> random_acc{-1 / 10'000.f,
-													 1 / 10'000.f};
+	std::uniform_real_distribution<double> random_acc{-1 / 10'000.,
+													  1 / 10'000.};
 
 	lclock test_data_clock{};
 	DegPos last = office;
 	size_t generated{0};
 	std::vector<DegPos> gps_samples{};
+	std::vector<double> gps_times{};
 	std::array<DegPos, 2> gps_boundingbox{office, office};
 	void update();
 };
 
 struct mock_device : mock_gps, mock_imu {
 	using mock_gps::gps_samples;
+	using mock_gps::gps_times;
+	using mock_imu::attitude;
+	using mock_imu::clock;
 	using mock_imu::imu_direction;
 	using mock_imu::imu_samples;
+	using mock_imu::imu_times;
 	std::string label{"mock_data"};
 
 	void update() {
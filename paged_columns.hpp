@@ -0,0 +1,131 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// how much history a store keeps. whole pages are evicted from the front
+struct retention {
+	double seconds = 0; // span of the key column to keep, 0 for no limit
+	size_t bytes = 0;	// memory budget, 0 for no limit
+};
+
+// append only column store split in fixed size pages. a page is reserved
+// once and never grows past it, so appending never copies old samples and
+// the memory in use is a whole number of pages.
+// every page after the first starts with a copy of the last row of the one
+// before it, so a line drawn page by page has no gaps
+template <typename T, size_t Columns> class paged_columns {
+  public:
+	using row = std::array<T, Columns>;
+	struct page {
+		std::array<std::vector<T>, Columns> cols{};
+		auto size() const -> size_t { return cols[0].size(); }
+		auto front(size_t c) const -> T { return cols[c].front(); }
+		auto back(size_t c) const -> T { return cols[c].back(); }
+	};
+
+	static constexpr auto default_page_rows = size_t{4096};
+
+	paged_columns() : paged_columns(default_page_rows) {}
+	explicit paged_columns(size_t rows) : page_rows{rows < 2 ? 2 : rows} {}
+
+	void push(const row &r) {
+		if (pages_.empty() || pages_.back().size() == page_rows) {
+			add_page();
+		}
+		auto &p = pages_.back();
+		for (auto c = size_t{0}; c < Columns; ++c) {
+			p.cols[c].push_back(r[c]);
+		}
+	}
+
+	auto pages() const -> const std::deque<page> & { return pages_; }
+	auto empty() const -> bool { return pages_.empty(); }
+	// retained rows, not counting the copies at the start of the pages
+	auto size() const -> size_t {
+		auto n = size_t{0};
+		for (const auto &p : pages_) {
+			n += p.size();
+		}
+		return pages_.empty() ? 0 : n - (pages_.size() - 1);
+	}
+	auto page_bytes() const -> size_t {
+		return page_rows * Columns * sizeof(T);
+	}
+	auto bytes() const -> size_t { return pages_.size() * page_bytes(); }
+	auto front(size_t c) const -> T { return pages_.front().front(c); }
+	auto back(size_t c) const -> T { return pages_.back().back(c); }
+	auto back_row() const -> row {
+		auto r = row{};
+		for (auto c = size_t{0}; c < Columns; ++c) {
+			r[c] = back(c);
+		}
+		return r;
+	}
+	// overwrites the last row, for rows that are still being accumulated
+	void replace_back(const row &r) {
+		auto &p = pages_.back();
+		for (auto c = size_t{0}; c < Columns; ++c) {
+			p.cols[c].back() = r[c];
+		}
+	}
+
+	// drops pages from the front while keep is violated: the store is over
+	// the byte budget, or the newest value of the key column in the page is
+	// older than keep.seconds. the page being written is never dropped
+	void trim(const retention &keep, size_t key = 0) {
+		while (pages_.size() > 1) {
+			const auto over_budget = keep.bytes > 0 && bytes() > keep.bytes;
+			const auto too_old =
+				keep.seconds > 0 && double(pages_.front().back(key)) <
+										double(back(key)) - keep.seconds;
+			if (!over_budget && !too_old) {
+				break;
+			}
+			evict_front();
+		}
+	}
+
+	// drops the front pages that hold only keys older than oldest
+	void drop_before(T oldest, size_t key = 0) {
+		while (pages_.size() > 1 && pages_.front().back(key) < oldest) {
+			evict_front();
+		}
+	}
+
+	void clear() {
+		pages_.clear();
+		spare.reset();
+	}
+
+  private:
+	void evict_front() {
+		spare = std::move(pages_.front());
+		pages_.pop_front();
+	}
+
+	void add_page() {
+		// the last evicted page keeps its allocation and is reused, in steady
+		// state the store does not allocate at all
+		auto p = spare ? std::move(*spare) : page{};
+		spare.reset();
+		for (auto &c : p.cols) {
+			c.clear();
+			c.reserve(page_rows);
+		}
+		if (!pages_.empty()) {
+			const auto &last = pages_.back();
+			for (auto c = size_t{0}; c < Columns; ++c) {
+				p.cols[c].push_back(last.back(c));
+			}
+		}
+		pages_.push_back(std::move(p));
+	}
+
+	size_t page_rows;
+	std::deque<page> pages_{};
+	std::optional<page> spare{};
+};
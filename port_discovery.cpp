@@ -0,0 +1,171 @@
+#include "port_discovery.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+port_discovery::port_discovery(opener o, const config &c)
+	: open{std::move(o)}, cfg{c} {
+	thread = std::jthread{[this](std::stop_token stop) { run(stop); }};
+}
+
+auto port_discovery::take() -> std::vector<event> {
+	auto lock = std::lock_guard{m};
+	return std::exchange(pending, {});
+}
+
+void port_discovery::post(event e) {
+	auto lock = std::lock_guard{m};
+	pending.push_back(std::move(e));
+}
+
+void port_discovery::forget(std::string name) {
+	auto lock = std::lock_guard{m};
+	forgotten.push_back(std::move(name));
+}
+
+auto port_discovery::forgetting() -> bool {
+	auto lock = std::lock_guard{m};
+	return !forgotten.empty();
+}
+
+void port_discovery::rescan(std::stop_token stop) {
+	{
+		auto lock = std::lock_guard{m};
+		for (const auto &name : forgotten) {
+			known.erase(name);
+		}
+		forgotten.clear();
+	}
+
+	auto ports = get_ports();
+	auto present = std::unordered_set<std::string>{};
+	auto fresh = std::vector<port>{};
+	for (auto &p : ports) {
+		auto name = p.name();
+		if (!known.contains(name)) {
+			fresh.push_back(std::move(p));
+		}
+		present.insert(std::move(name));
+	}
+
+	// the ports gone are reported before the new ones are probed
+	std::erase_if(known, [&](const auto &name) {
+		if (present.contains(name)) {
+			return false;
+		}
+		spdlog::info("{}: gone", name);
+		post(lost{name});
+		return true;
+	});
+
+	// side by side, each posted as soon as it is open or failed: n silent
+	// ports take one probe, not n of them. the next rescan waits for the
+	// slowest, at most one probe budget
+	auto tasks = std::vector<std::jthread>{};
+	tasks.reserve(fresh.size());
+	for (auto &p : fresh) {
+		auto name = p.name();
+		known.insert(name);
+		tasks.emplace_back(
+			[this, &stop, name = std::move(name), p = std::move(p)]() mutable {
+				try {
+					auto dev = open(std::move(p), stop);
+					spdlog::info("{}: opened", name);
+					post(opened{std::move(name), std::move(dev)});
+				} catch (const std::exception &e) {
+					spdlog::error("{}: cannot open: {}", name, e.what());
+					post(failed{std::move(name), e.what()});
+				}
+			});
+	}
+}
+
+#ifdef __linux__
+// a socket on the kernel uevents, -1 if there is none
+static auto uevent_socket() -> int {
+	const auto fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC,
+						   NETLINK_KOBJECT_UEVENT);
+	if (fd < 0) {
+		return -1;
+	}
+	auto addr = sockaddr_nl{};
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = 1; // the kernel ones, before udev handles them
+	if (bind(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) <
+		0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+// whether the pending uevents concern a tty, reads them all
+static auto tty_uevent(int fd) -> bool {
+	auto buf = std::array<char, 4096>{};
+	auto tty = false;
+	for (;;) {
+		const auto n = recv(fd, buf.data(), buf.size(), MSG_DONTWAIT);
+		if (n <= 0) {
+			return tty;
+		}
+		// "action@devpath\0KEY=value\0KEY=value..."
+		const auto msg = std::string_view(buf.data(), size_t(n));
+		tty = tty || msg.find(std::string_view("\0SUBSYSTEM=tty\0", 15)) !=
+						 std::string_view::npos;
+	}
+}
+
+void port_discovery::run(std::stop_token stop) {
+	using clock = std::chrono::steady_clock;
+	using ms = std::chrono::milliseconds;
+
+	const auto fd = uevent_socket();
+	if (fd < 0) {
+		spdlog::warn("no uevents, looking for serial ports every {} ms",
+					 cfg.rescan_ms);
+	}
+	const auto period = ms{fd < 0 ? cfg.rescan_ms : cfg.uevent_rescan_ms};
+	auto next = clock::now();
+	while (!stop.stop_requested()) {
+		if (clock::now() >= next) {
+			rescan(stop);
+			next = clock::now() + period;
+		}
+		// short waits, the stop request is only seen in between
+		auto pfd = pollfd{.fd = fd, .events = POLLIN, .revents = 0};
+		const auto ready = poll(&pfd, 1, 250);
+		if ((ready > 0 && tty_uevent(fd)) || forgetting()) {
+			next = std::min(next, clock::now() + ms{cfg.settle_ms});
+		}
+	}
+	if (fd >= 0) {
+		close(fd);
+	}
+}
+#else
+void port_discovery::run(std::stop_token stop) {
+	auto sleep = std::mutex{};
+	auto cv = std::condition_variable_any{};
+	while (!stop.stop_requested()) {
+		rescan(stop);
+		auto lock = std::unique_lock{sleep};
+		cv.wait_for(lock, stop, std::chrono::milliseconds{cfg.rescan_ms},
+					[] { return false; });
+	}
+}
+#endif
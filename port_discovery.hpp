@@ -0,0 +1,76 @@
+#pragma once
+#include "serial_device.hpp"
+#include "serial_port.hpp"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+// watches the serial ports of the system from a thread of its own: the port
+// list is read again whenever the kernel announces a tty coming or going
+// (netlink uevents on linux) and every rescan_ms anyway, the only way
+// elsewhere. new ports are opened from that thread, each on a task of its
+// own: probing takes seconds, a slow or stuck tty holds up discovery and
+// nothing else, and the results are queued for the ui thread to take.
+// a port that fails to open is reported once and tried again only after it
+// went away and came back
+class port_discovery {
+  public:
+	struct opened {
+		std::string name;
+		std::unique_ptr<device_samples> dev;
+	};
+	struct failed {
+		std::string name;
+		std::string error;
+	};
+	struct lost {
+		std::string name;
+	};
+	using event = std::variant<opened, failed, lost>;
+
+	// runs for each new port, concurrently with the other new ones, throws
+	// if it fails. stop is requested when discovery stops
+	using opener =
+		std::function<std::unique_ptr<device_samples>(port, std::stop_token)>;
+
+	struct config {
+		unsigned rescan_ms = 2'000;
+		// with uevents: the device node shows up a little after the event
+		unsigned settle_ms = 300;
+		// with uevents the rescan is only a safety net
+		unsigned uevent_rescan_ms = 30'000;
+	};
+
+	explicit port_discovery(opener o) : port_discovery(std::move(o), {}) {}
+	port_discovery(opener o, const config &c);
+
+	// the events since the last call, in order
+	auto take() -> std::vector<event>;
+
+	// a port whose device stopped and was dropped: it is opened again at
+	// the next rescan if it is still listed
+	void forget(std::string name);
+
+  private:
+	void run(std::stop_token stop);
+	void rescan(std::stop_token stop);
+	void post(event e);
+	auto forgetting() -> bool;
+
+	opener open;
+	config cfg;
+	// name of every port seen and not gone since
+	std::unordered_set<std::string> known{};
+	std::mutex m{};
+	std::vector<event> pending{};
+	std::vector<std::string> forgotten{};
+	// declared last: joined before anything it references is destroyed
+	std::jthread thread{};
+};
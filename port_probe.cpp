@@ -0,0 +1,78 @@
+#include "port_probe.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <span>
+#include <utility>
+#include <vector>
+
+// longest a read waits before the stop request is looked at again
+static constexpr auto stop_poll = std::chrono::milliseconds{100};
+
+// bytes received at the current rate, at most window of them, and what
+// they decode to
+static auto listen(open_port &p, std::chrono::milliseconds slice,
+				   const probe_config &c, std::stop_token stop)
+	-> std::pair<size_t, protocol_score> {
+	using clock = std::chrono::steady_clock;
+	const auto until = clock::now() + slice;
+	auto buf = std::vector<char>(c.window);
+	auto got = size_t{0};
+	auto score = protocol_score{};
+	while (got < buf.size() && !stop.stop_requested()) {
+		const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+			until - clock::now());
+		if (left.count() <= 0) {
+			break;
+		}
+		const auto n = p.read_some(std::span(buf).subspan(got),
+								   unsigned(std::min(left, stop_poll).count()));
+		if (n == 0) {
+			continue;
+		}
+		got += n;
+		// rescoring the window is cheap next to waiting for the bytes
+		score = score_protocols(std::span(buf).first(got));
+		if (score.records() >= c.enough) {
+			break;
+		}
+	}
+	return {got, score};
+}
+
+auto probe_port(open_port &p, const probe_config &c, std::stop_token stop)
+	-> probe_result {
+	const auto slice = std::chrono::milliseconds{
+		c.bauds.empty() ? 0 : c.budget_ms / c.bauds.size()};
+	auto best = probe_result{};
+	auto bytes = size_t{0};
+	for (const auto baud : c.bauds) {
+		p.set_config({baud});
+		// what came in at the previous rate would count for this one
+		wrap(sp_flush(p, SP_BUF_INPUT));
+		const auto [got, score] = listen(p, slice, c, stop);
+		bytes += got;
+		spdlog::debug("{}: {} baud, {} bytes, {} frames, {} lines", p.name(),
+					  baud, got, score.frames, score.lines);
+		if (best.baud == 0 || score.records() > best.records) {
+			best = {baud, score.best(c.evidence), score.records(), 0};
+		}
+		if (score.records() >= c.enough || stop.stop_requested()) {
+			break;
+		}
+	}
+
+	// ties go to the earlier rate: a silent port ends up at the first one
+	best.bytes = bytes;
+	if (best.baud != 0) {
+		p.set_config({best.baud});
+	}
+	return best;
+}
+
+auto is_noise(const probe_result &r, const probe_config &c) -> bool {
+	return r.proto == protocol::autodetect && r.records == 0 &&
+		   r.bytes >= c.noise;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "frame.hpp"
+#include "serial_port.hpp"
+
+#include <cstddef>
+#include <stop_token>
+#include <vector>
+
+struct probe_config {
+	// tried in this order, the first one is also used for silent ports
+	std::vector<int> bauds{230400, 115200, 460800, 921600, 57600, 9600};
+	// for the whole probe, split evenly among the rates
+	unsigned budget_ms = 3'000;
+	// records that lock a rate in at once
+	size_t enough = 8;
+	// records below which a rate does not count as speaking at all
+	size_t evidence = 3;
+	// bytes scored per rate at most
+	size_t window = 4096;
+	// bytes over the whole probe, with no record at any rate, for a port to
+	// count as sending noise. below it the port may just be slow (a 1 Hz
+	// gps, a boot banner) and is read in autodetection
+	size_t noise = 2048;
+};
+
+struct probe_result {
+	int baud = 0;
+	protocol proto = protocol::autodetect;
+	size_t records = 0; // decoded at baud
+	size_t bytes = 0;	// received over the whole probe
+};
+
+// listens to p at each rate of c.bauds in turn, scoring what arrives with
+// score_protocols, and leaves the port configured at the best rate. stops
+// as soon as a rate decodes c.enough records, or early when stop is
+// requested.
+// proto stays autodetect if no rate got to c.evidence records: bytes and
+// records then tell a silent port (left at the first rate) from one that
+// only sent noise
+auto probe_port(open_port &p, const probe_config &c,
+				std::stop_token stop = {}) -> probe_result;
+
+// whether a probe found c.noise bytes or more and not a single record
+auto is_noise(const probe_result &r, const probe_config &c) -> bool;
@@ -0,0 +1,66 @@
+#pragma once
+#include "gps.hpp"
+#include "imu.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <string_view>
+#include <variant>
+
+// one specialization per record type of the line protocol: the tag is the
+// first field of the line, parse decodes the fields that follow it
+template <typename T> struct record_traits;
+
+template <> struct record_traits<imu> {
+	static constexpr auto tag = std::string_view{"imu"};
+	static auto parse(std::string_view sv) { return parse_imu_fields(sv); }
+};
+
+template <> struct record_traits<gps_hybrid> {
+	static constexpr auto tag = std::string_view{"gpsrmc"};
+	static auto parse(std::string_view sv) {
+		return parse_gps_hybrid_fields(sv);
+	}
+};
+
+// compile time dispatch table over the record types: the tag of a line is
+// read once and only the decoder registered for it runs.
+// to add a record type specialize record_traits and list it in `records`
+template <typename... R> struct record_set {
+	using variant = std::variant<R...>;
+
+	static constexpr auto max_tag = std::max({record_traits<R>::tag.size()...});
+
+	// tags are short, only the first max_tag + 1 bytes are ever looked at
+	static constexpr auto tag_of(std::string_view line) -> std::string_view {
+		const auto head = std::min(line.size(), max_tag + 1);
+		auto len = size_t{0};
+		while (len < head && line[len] != ';') {
+			++len;
+		}
+		return line.substr(0, len);
+	}
+
+	static auto parse(std::string_view line) -> std::optional<variant> {
+		const auto tag = tag_of(line);
+		auto res = std::optional<variant>{};
+		(void)((tag == record_traits<R>::tag && decode<R>(line, res)) || ...);
+		return res;
+	}
+
+  private:
+	template <typename T>
+	static auto decode(std::string_view line, std::optional<variant> &res)
+		-> bool {
+		const auto skip = record_traits<T>::tag.size() + 1;
+		const auto fields = line.substr(std::min(line.size(), skip));
+		if (auto r = record_traits<T>::parse(fields)) {
+			res.emplace(std::in_place_type<T>, *r);
+		}
+		// the tag matched, no other decoder can accept the line
+		return true;
+	}
+};
+
+using records = record_set<imu, gps_hybrid>;
+using record = records::variant;
@@ -0,0 +1,123 @@
+#pragma once
+#include "attitude.hpp"
+#include "gps.hpp"
+#include "gps_index.hpp"
+#include "gps_track.hpp"
+#include "imu.hpp"
+#include "imu_store.hpp"
+#include "time_base.hpp"
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+// anything that produces samples: mock_device, device_samples, ...
+// new samples are accumulated by update() and taken away by the cache,
+// which then clears them
+template <typename S>
+concept sample_source = requires(S &s) {
+	{ s.label } -> std::convertible_to<std::string>;
+	s.update();
+	std::span<const imu>(s.imu_samples);
+	// on the host timeline, one per sample
+	std::span<const double>(s.imu_times);
+	std::span<const float, 3>(s.imu_direction);
+	{ s.attitude.stats() } -> std::same_as<attitude_stats>;
+	{ s.clock.stats() } -> std::same_as<clock_stats>;
+	std::span<const DegPos>(s.gps_samples);
+	std::span<const double>(s.gps_times);
+	std::span<const DegPos, 2>(s.gps_boundingbox);
+	s.imu_samples.clear();
+	s.imu_times.clear();
+	s.gps_samples.clear();
+	s.gps_times.clear();
+};
+
+// ui side copy of the data of one source, in the shape the widgets want.
+// the source is one of a closed set of types, so a single visit per frame
+// dispatches to a transfer loop compiled for that exact type
+template <sample_source... S> struct samples_cache {
+	std::variant<S *...> src;
+	imu_columns imu{};
+	std::array<float, 3> imu_direction{};
+	attitude_stats attitude{};
+	clock_stats clock{};
+	gps_track gps{};
+	gps_index gps_fixes{gps.meter() * 10};
+	std::array<DegPos, 2> gps_boundingbox{};
+
+	auto label() const -> const std::string & {
+		return std::visit(
+			[](auto *s) -> const std::string & { return s->label; }, src);
+	}
+
+	void update() {
+		std::visit([&](auto *s) { pull(*s); }, src);
+	}
+
+	// projects the retained fixes again on p, the track and the index are
+	// rebuilt from them. on the local plane the oldest of them is the origin
+	void project_on(gps_track::projection p) {
+		if (p == gps.projected_on()) {
+			return;
+		}
+		const auto fixes = gps_fixes.in_order();
+		gps = gps_track{p};
+		gps_fixes = gps_index{gps.meter() * 10};
+		auto pos = std::vector<DegPos>{};
+		auto times = std::vector<double>{};
+		pos.reserve(fixes.size());
+		times.reserve(fixes.size());
+		for (const auto &f : fixes) {
+			pos.push_back(f.pos);
+			times.push_back(f.t);
+		}
+		push_fixes(pos, times);
+	}
+
+  private:
+	void push_fixes(std::span<const DegPos> fixes,
+					std::span<const double> times) {
+		gps.push(fixes, [&](const DegPos &p, const auto &r) {
+			const auto t = times[size_t(&p - fixes.data())];
+			gps_fixes.add({r[gps_track::x], r[gps_track::y],
+						   r[gps_track::n], p, t});
+		});
+		gps.trim();
+		if (!gps.empty()) {
+			gps_fixes.drop_before(gps.at(0).front(gps_track::n));
+		}
+	}
+
+	template <sample_source T> void pull(T &s) {
+		s.update();
+		if (!s.imu_samples.empty()) {
+			for (auto i = size_t{0}; i < s.imu_samples.size(); ++i) {
+				imu.push(s.imu_samples[i], s.imu_times[i]);
+			}
+			imu.trim();
+			s.imu_samples.clear();
+			s.imu_times.clear();
+			std::ranges::copy(s.imu_direction, imu_direction.begin());
+			attitude = s.attitude.stats();
+			clock = s.clock.stats();
+		}
+
+		if (!s.gps_samples.empty()) {
+			push_fixes(s.gps_samples, s.gps_times);
+			s.gps_samples.clear();
+			s.gps_times.clear();
+
+			const auto &bb = s.gps_boundingbox;
+			std::ranges::copy(bb, gps_boundingbox.begin());
+			spdlog::debug("bb: {}:{} {}:{}", bb[0].lat, bb[0].lon, bb[1].lat,
+						  bb[1].lon);
+		}
+	}
+};
@@ -0,0 +1,211 @@
+#include "serial_device.hpp"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wshadow"
+#include "fmt/compile.h"
+#pragma GCC diagnostic pop
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+
+void read_stats::add(size_t n, int64_t now) {
+	reads.fetch_add(1, std::memory_order_relaxed);
+	bytes.fetch_add(n, std::memory_order_relaxed);
+	if (last_us != 0) {
+		const auto d = now - last_us;
+		interval_sum_us.fetch_add(d, std::memory_order_relaxed);
+		if (d > interval_max_us.load(std::memory_order_relaxed)) {
+			interval_max_us.store(d, std::memory_order_relaxed);
+		}
+	}
+	last_us = now;
+}
+
+auto read_stats::get() const -> summary {
+	auto s = summary{.reads = reads.load(), .bytes = bytes.load()};
+	if (s.reads > 0) {
+		s.bytes_per_read = double(s.bytes) / double(s.reads);
+	}
+	if (s.reads > 1) {
+		s.mean_interval_ms =
+			double(interval_sum_us.load()) / double(s.reads - 1) / 1000.;
+	}
+	s.max_interval_ms = double(interval_max_us.load()) / 1000.;
+	return s;
+}
+
+void read_stats::reset() {
+	reads = 0;
+	bytes = 0;
+	interval_sum_us = 0;
+	interval_max_us = 0;
+}
+
+void line_getter::pull() {
+	if (backlog && !blocking) {
+		// woken by the reactor: the lines already here go first, if the
+		// port has more it calls again
+		return;
+	}
+	const auto dest = buf.writable(read_chunk);
+	if (dest.empty()) {
+		return;
+	}
+	// the whole free tail in one read. only the reader thread may block,
+	// and only when it has no lines left to hand out. how many bytes a read
+	// finds is up to the read strategy of the port (open_port::tune)
+	const auto in_count =
+		blocking && !backlog
+			? p.read_some(dest, read_timeout_ms)
+			: size_t(wrap(sp_nonblocking_read(p, dest.data(), dest.size())));
+	buf.commit(in_count);
+	if (in_count > 0) {
+		if (stats) {
+			stats->add(in_count, host_us());
+		}
+		spdlog::debug(FMT_COMPILE("pulled {} bytes from {}"), in_count,
+					  p.name());
+	}
+}
+
+auto data_source::parse(std::string_view line) -> std::optional<record> {
+	spdlog::debug("line: {}", line);
+	auto res = records::parse(line);
+	if (!res) {
+		spdlog::debug(R"(unhandled: "{}")", line);
+	}
+	return res;
+}
+
+void data_source::detect() {
+	get.drain_bytes([&](std::span<const char> bytes) {
+		mode = detect_protocol(bytes);
+		if (mode != protocol::autodetect) {
+			spdlog::info("{}: speaking {} protocol", get.p.name(),
+						 mode == protocol::binary ? "binary" : "text");
+			binary_junk = 0;
+			// the decoder of the chosen protocol starts from these bytes
+			return std::pair{size_t{0}, true};
+		}
+		// no luck so far: keep only the most recent window
+		const auto drop =
+			bytes.size() > detect_window ? bytes.size() - detect_window : 0;
+		return std::pair{drop, false};
+	});
+}
+
+void data_source::fallback() {
+	spdlog::warn("{}: no valid frame in {} bytes, detecting again",
+				 get.p.name(), binary_junk);
+	mode = protocol::autodetect;
+	binary_junk = 0;
+}
+
+// one drain of src into the ring
+static void ingest(data_source &src, device_samples::shared_state &shared,
+				   const std::string &label) {
+	auto now = int64_t{0};
+	src.drain([&](const record &sample) {
+		// the records of one read share its time, one clock read
+		if (now == 0) {
+			now = host_us();
+		}
+		if (!shared.ring.push({sample, now})) {
+			// the ui is not keeping up, losing the newest sample is the
+			// only option that does not involve the consumer
+			if (shared.dropped++ % 1024 == 0) {
+				spdlog::warn("{}: ring full, dropped {} samples", label,
+							 shared.dropped.load());
+			}
+		}
+	});
+}
+
+static void read_loop(std::stop_token stop, data_source src,
+					  device_samples::shared_state &shared,
+					  const std::string &label) {
+	try {
+		while (!stop.stop_requested()) {
+			ingest(src, shared, label);
+		}
+	} catch (const std::exception &e) {
+		spdlog::error("{}: reader stopped: {}", label, e.what());
+	}
+	shared.alive = false;
+}
+
+device_samples::device_samples(open_port &&p, protocol proto,
+							   io_reactor *r)
+	: label{fmt::format(FMT_COMPILE("{}-{}"), p.name(), p.description())},
+	  shared{std::make_unique<shared_state>()}, port{p} {
+	auto s = data_source{.get = line_getter(std::move(p)), .mode = proto};
+	s.get.stats = &shared->reads;
+	if (!r || sp_get_port_handle(s.get.p, &fd) != SP_OK) {
+		reader = std::jthread{read_loop, std::move(s), std::ref(*shared),
+							  label};
+		return;
+	}
+
+	s.get.blocking = false;
+	src = std::make_unique<data_source>(std::move(s));
+	r->watch(fd, [&src = *src, &sh = *shared, l = label](bool hangup) {
+		try {
+			do {
+				ingest(src, sh, l);
+			} while (src.get.backlog);
+		} catch (const std::exception &e) {
+			spdlog::error("{}: reader stopped: {}", l, e.what());
+			hangup = true;
+		}
+		if (hangup) {
+			sh.alive = false;
+		}
+		return !hangup;
+	});
+	reactor = r;
+}
+
+void device_samples::tune(const read_strategy &s) {
+	port.tune(s);
+	strategy = s;
+}
+
+device_samples::~device_samples() {
+	// the port closes once src and port are gone, after this: its fd is not
+	// reused while the reactor still watches it
+	if (reactor) {
+		reactor->unwatch(fd);
+	}
+}
+
+void device_samples::update_bb(const DegPos &pos) {
+	auto &[ul, dr] = gps_boundingbox;
+	ul.lat = std::max(ul.lat, pos.lat);
+	dr.lat = std::min(dr.lat, pos.lat);
+	ul.lon = std::min(ul.lon, pos.lon);
+	dr.lon = std::max(dr.lon, pos.lon);
+}
+
+void device_samples::consume(const stamped_record &sample) {
+	if (const auto *s = std::get_if<imu>(&sample.rec)) {
+		const auto t = clock.tick(s->ts, sample.host_us);
+		attitude.update(*s, t.dt);
+		imu_samples.emplace_back(*s);
+		imu_times.push_back(t.t);
+		return;
+	}
+
+	if (const auto *g = std::get_if<gps_hybrid>(&sample.rec)) {
+		auto pos = DegPos(g->pos);
+		update_bb(pos);
+		gps_samples.emplace_back(pos);
+		gps_times.push_back(gps_time.tick(g->ts, sample.host_us));
+	}
+}
+
+void device_samples::update() {
+	shared->ring.drain([&](const stamped_record &s) { consume(s); },
+					   update_budget);
+	imu_direction = to_turns(attitude.euler());
+}
@@ -0,0 +1,212 @@
+#pragma once
+#include "attitude.hpp"
+#include "frame.hpp"
+#include "io_reactor.hpp"
+#include "line_buffer.hpp"
+#include "records.hpp"
+#include "serial_port.hpp"
+#include "spsc_ring.hpp"
+#include "time_base.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+// what the reads of a port bring in, counted by its reader and shown by
+// the ui
+struct read_stats {
+	std::atomic<size_t> reads{0}; // that brought data
+	std::atomic<size_t> bytes{0};
+	// time between reads that brought data: how long the bytes can sit in
+	// the driver and in the adapter before the reader sees them
+	std::atomic<int64_t> interval_sum_us{0};
+	std::atomic<int64_t> interval_max_us{0};
+
+	struct summary {
+		size_t reads = 0;
+		size_t bytes = 0;
+		double bytes_per_read = 0;
+		double mean_interval_ms = 0;
+		double max_interval_ms = 0;
+	};
+
+	// reader side, n bytes read at host time now
+	void add(size_t n, int64_t now);
+	auto get() const -> summary;
+	void reset();
+
+  private:
+	int64_t last_us = 0; // reader side only
+};
+
+struct line_getter {
+	static constexpr auto read_chunk = size_t{1024};
+	static constexpr auto read_timeout_ms = 100u;
+	// upper bound on the lines handed out by a single drain()
+	static constexpr auto default_budget = size_t{512};
+
+	line_buffer buf{};
+	bool backlog = false;
+	// false when an io_reactor says when the port has data: pull() then
+	// never blocks
+	bool blocking = true;
+	read_stats *stats = nullptr;
+	open_port p;
+	line_getter(open_port op) : p{std::move(op)} {}
+
+	// pulls everything the port has ready (blocking up to read_timeout_ms if
+	// there is nothing to do) then calls f(std::string_view) on every complete
+	// line, at most budget of them. the views point inside buf and are valid
+	// only during the call. returns the number of lines handed out
+	template <typename F>
+	auto drain(F &&f, size_t budget = default_budget) -> size_t {
+		pull();
+
+		auto count = size_t{0};
+		for (; count < budget; ++count) {
+			const auto line = buf.next_line();
+			if (!line) {
+				break;
+			}
+			f(*line);
+		}
+		backlog = count == budget;
+		return count;
+	}
+
+	// same pull as drain(), then hands all the unconsumed bytes to
+	// f(std::span<const char>) which returns how many it used up and whether
+	// it left work behind (a budget was hit)
+	template <typename F> void drain_bytes(F &&f) {
+		pull();
+		const auto [used, more] = f(buf.unconsumed());
+		buf.consume(used);
+		backlog = more;
+	}
+
+  private:
+	void pull();
+};
+
+struct data_source {
+	// garbage tolerated in binary mode before going back to autodetection
+	static constexpr auto max_binary_junk = size_t{4096};
+	// undecided bytes kept around while autodetecting
+	static constexpr auto detect_window = size_t{4096};
+
+	line_getter get;
+	protocol mode = protocol::autodetect;
+	size_t binary_junk = 0;
+
+	// calls f(const record &) for every record received, at most budget of
+	// them, with the protocol in use on the port. see line_getter::drain
+	template <typename F>
+	auto drain(F &&f, size_t budget = line_getter::default_budget) -> size_t {
+		switch (mode) {
+		case protocol::text:
+			return get.drain(
+				[&](std::string_view line) {
+					if (auto r = parse(line)) {
+						f(*r);
+					}
+				},
+				budget);
+		case protocol::binary:
+			return drain_binary(f, budget);
+		case protocol::autodetect:
+			detect();
+			return 0;
+		}
+		return 0;
+	}
+
+	static auto parse(std::string_view line) -> std::optional<record>;
+
+  private:
+	template <typename F> auto drain_binary(F &&f, size_t budget) -> size_t {
+		auto frames = size_t{0};
+		get.drain_bytes([&](std::span<const char> bytes) {
+			const auto scan = decode_frames(bytes, f, budget);
+			frames = scan.frames;
+			binary_junk = scan.frames > 0 ? scan.skipped
+										  : binary_junk + scan.skipped;
+			if (binary_junk > max_binary_junk) {
+				// the device went back to text (or was never binary)
+				fallback();
+			}
+			return std::pair{scan.consumed, scan.frames == budget};
+		});
+		return frames;
+	}
+
+	void detect();
+	void fallback();
+};
+
+// a record and the host time the read that brought it returned at
+struct stamped_record {
+	record rec;
+	int64_t host_us = 0;
+};
+
+// ~70 s of imu data at 59 Hz before the reader starts dropping
+using record_ring = spsc_ring<stamped_record, 4096>;
+
+struct device_samples {
+	std::vector<imu> imu_samples{};
+	// on the host timeline, s, one per sample
+	std::vector<double> imu_times{};
+	// roll, pitch, yaw in turns
+	std::array<float, 3> imu_direction{};
+	attitude_filter attitude{};
+	device_clock clock{};
+	std::vector<DegPos> gps_samples{};
+	std::vector<double> gps_times{};
+	gps_clock gps_time{};
+	std::array<DegPos, 2> gps_boundingbox{};
+	std::string label;
+
+	// shared with the reader, heap allocated so that device_samples can be
+	// moved around while the reader is running
+	struct shared_state {
+		record_ring ring{};
+		std::atomic<size_t> dropped{0};
+		std::atomic<bool> alive{true};
+		read_stats reads{};
+	};
+	std::unique_ptr<shared_state> shared;
+	// the port as the ui sees it, for tuning while the reader runs
+	open_port port;
+	read_strategy strategy{};
+	// the port is read either by the reactor, which calls back into src
+	// when it has data, or by a thread of its own
+	io_reactor *reactor = nullptr;
+	int fd = -1;
+	std::unique_ptr<data_source> src{};
+	// declared last: joined before anything it references is destroyed
+	std::jthread reader{};
+
+	// reactor can be null, the port then gets a reader thread
+	device_samples(open_port &&p, protocol proto = protocol::autodetect,
+				   io_reactor *reactor = nullptr);
+	// changes the read strategy of the port, see open_port::tune
+	void tune(const read_strategy &s);
+	~device_samples();
+	device_samples(const device_samples &) = delete;
+	auto operator=(const device_samples &) -> device_samples & = delete;
+
+	void update_bb(const DegPos &pos);
+	// upper bound on the samples moved out of the ring by a single update()
+	static constexpr auto update_budget = record_ring::capacity() / 2;
+
+	// drains what the reader thread produced since the last call
+	void update();
+
+  private:
+	void consume(const stamped_record &sample);
+};
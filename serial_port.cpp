@@ -0,0 +1,127 @@
+#include "serial_port.hpp"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wshadow"
+#include "fmt/compile.h"
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#include "magic_enum.hpp"
+#pragma GCC diagnostic pop
+
+#include "spdlog/spdlog.h"
+
+#ifdef __linux__
+#include <cerrno>
+
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#endif
+
+template <typename T>
+struct fmt::formatter<T, std::enable_if_t<std::is_enum_v<T>>> {
+
+	constexpr auto parse(format_parse_context &ctx) { return ctx.end(); }
+
+	auto format(auto t, auto &fc) {
+		return fmt::format_to(fc.out(), FMT_COMPILE("{}"),
+							  magic_enum::enum_name(t));
+	}
+};
+
+config::config() {
+	sp_port_config *dest;
+	sp_new_config(&dest);
+	p.reset(dest);
+}
+
+config::config(int baudrate) : config() {
+	sp_set_config_baudrate(p.get(), baudrate);
+	sp_set_config_bits(p.get(), 8);
+	sp_set_config_parity(p.get(), sp_parity::SP_PARITY_NONE);
+	sp_set_config_stopbits(p.get(), 1);
+
+	sp_set_config_cts(p.get(), sp_cts::SP_CTS_IGNORE);
+	sp_set_config_dsr(p.get(), sp_dsr::SP_DSR_IGNORE);
+	sp_set_config_dtr(p.get(), sp_dtr::SP_DTR_OFF);
+	sp_set_config_flowcontrol(p.get(), sp_flowcontrol::SP_FLOWCONTROL_NONE);
+	sp_set_config_rts(p.get(), sp_rts::SP_RTS_OFF);
+	sp_set_config_xon_xoff(p.get(), sp_xonxoff::SP_XONXOFF_DISABLED);
+}
+
+// the port itself stays closed, what is opened is a copy of it that closes
+// when freed. closing one that failed to open only returns an error
+static auto open_copy(const sp_port *source) -> sp_port_p {
+	sp_port *dest;
+	wrap(sp_copy_port(source, &dest));
+	auto p = sp_port_p{dest, sp_open_port_deleter};
+	wrap(sp_open(p.get(), sp_mode::SP_MODE_READ));
+	return p;
+}
+
+auto port::open() & -> open_port { return open_port{open_copy(p.get())}; }
+auto port::open() && -> open_port { return open_port{open_copy(p.get())}; }
+
+#ifdef __linux__
+auto open_port::tune(const read_strategy &s) -> open_port & {
+	auto fd = -1;
+	wrap(sp_get_port_handle(p.get(), &fd));
+
+	auto t = termios{};
+	if (tcgetattr(fd, &t) < 0) {
+		throw sys_exception(errno, std::system_category(), "tcgetattr");
+	}
+	t.c_cc[VMIN] = s.min_chunk;
+	t.c_cc[VTIME] = s.inter_byte_ds;
+	if (tcsetattr(fd, TCSANOW, &t) < 0) {
+		throw sys_exception(errno, std::system_category(), "tcsetattr");
+	}
+
+	if (s.low_latency) {
+		auto ss = serial_struct{};
+		if (ioctl(fd, TIOCGSERIAL, &ss) < 0) {
+			spdlog::warn("{}: no low latency flag: {}", name(),
+						 std::system_category().message(errno));
+			return *this;
+		}
+		// the flags are an int, the flag constants unsigned
+		const auto flags = unsigned(ss.flags);
+		ss.flags = int(*s.low_latency ? flags | ASYNC_LOW_LATENCY
+									  : flags & ~ASYNC_LOW_LATENCY);
+		if (ioctl(fd, TIOCSSERIAL, &ss) < 0) {
+			spdlog::warn("{}: cannot set the low latency flag: {}", name(),
+						 std::system_category().message(errno));
+		}
+	}
+	return *this;
+}
+#else
+auto open_port::tune(const read_strategy &) -> open_port & { return *this; }
+#endif
+
+auto get_ports() -> std::vector<port> {
+	spdlog::debug("Getting port list");
+
+	sp_port **port_list;
+	const auto result = sp_list_ports(&port_list);
+
+	if (result != SP_OK) {
+		spdlog::warn("sp_list_ports() failed: {}", result);
+		return {};
+	}
+
+	/* Iterate through the ports. When port_list[i] is NULL
+	 * this indicates the end of the list. */
+	auto res = std::vector<port>{};
+	for (auto i = 0; port_list[i] != NULL; ++i) {
+		res.emplace_back(port_list[i]);
+		spdlog::debug(FMT_COMPILE("Found port: {}"),
+					  sp_get_port_name(port_list[i]));
+	}
+	spdlog::debug(FMT_COMPILE("Found {} ports"), res.size());
+
+	sp_free_port_list(port_list);
+	return res;
+}
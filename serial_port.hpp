@@ -0,0 +1,146 @@
+#pragma once
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <vector>
+
+extern "C" {
+#include "libserialport.h"
+}
+
+struct arg_exception : public std::exception {};
+struct mem_exception : public std::exception {};
+struct supp_exception : public std::exception {};
+struct sys_exception : public std::system_error {
+	using std::system_error::system_error;
+};
+
+struct boh_exception : public std::exception {};
+
+int wrap(auto ret_code) {
+	if (ret_code >= 0) {
+		[[likely]] return ret_code;
+	}
+	switch (ret_code) {
+	case sp_return::SP_OK:
+		[[likely]] return 0;
+	case sp_return::SP_ERR_ARG:
+		throw arg_exception{};
+	case sp_return::SP_ERR_MEM:
+		[[unlikely]] throw mem_exception{};
+	case sp_return::SP_ERR_SUPP:
+		throw supp_exception{};
+	case sp_return::SP_ERR_FAIL:
+		throw sys_exception(sp_last_error_code(), std::system_category(),
+							sp_last_error_message());
+	}
+	{ [[unlikely]] throw boh_exception{}; }
+}
+
+inline constexpr auto sp_config_deleter = [](sp_port_config *p) {
+	sp_free_config(p);
+};
+struct config {
+	using sp_config_p =
+		std::unique_ptr<sp_port_config, decltype(sp_config_deleter)>;
+
+	sp_config_p p;
+	config();
+	config(int baudrate);
+
+	operator const sp_port_config *() const { return p.get(); }
+	operator sp_port_config *() { return p.get(); }
+};
+
+inline constexpr auto sp_port_deleter = [](sp_port *p) { sp_free_port(p); };
+// whoever lets go of an open port last closes it: the reader of a device,
+// the ui tuning it, or an open that threw half way
+inline constexpr auto sp_open_port_deleter = [](sp_port *p) {
+	sp_close(p);
+	sp_free_port(p);
+};
+using sp_port_p = std::shared_ptr<sp_port>; //, decltype(sp_port_deleter)>;
+
+// how the driver batches the bytes of a port before a read sees them,
+// latency traded for syscalls (termios VMIN/VTIME and the uart flags).
+// with inter_byte_ds at 0 a port counts as readable for poll and epoll only
+// once min_chunk bytes are in: the wakeups are what it saves, and the last
+// bytes of a burst wait for the next one. with a timer the port is readable
+// from the first byte and the two only shape blocking reads, as termios does
+struct read_strategy {
+	uint8_t min_chunk = 1;	   // VMIN
+	uint8_t inter_byte_ds = 0; // VTIME, tenths of second
+	// ASYNC_LOW_LATENCY: usb adapters (ftdi and alike) hand over their
+	// buffer right away instead of on their latency timer. left alone if
+	// not set, few drivers support it
+	std::optional<bool> low_latency{};
+};
+
+struct open_port;
+struct port {
+	sp_port_p p;
+
+	// explicit port(sp_port_p &&p_) : p{p_} {}
+	explicit port(sp_port *source) {
+		sp_port *dest;
+		sp_copy_port(source, &dest);
+		p = {dest, sp_free_port};
+	}
+
+	auto name() const noexcept -> std::string {
+		const auto res = sp_get_port_name(p.get());
+		return res ? res : "";
+	}
+	auto description() const noexcept -> std::string {
+		const auto res = sp_get_port_description(p.get());
+		return res ? res : "";
+	}
+
+	auto open() & -> open_port;
+	auto open() && -> open_port;
+};
+
+struct open_port {
+	sp_port_p p;
+
+	auto name() const noexcept -> std::string {
+		const auto res = sp_get_port_name(p.get());
+		return res ? res : "";
+	}
+	auto description() const noexcept -> std::string {
+		const auto res = sp_get_port_description(p.get());
+		return res ? res : "";
+	}
+
+	auto set_config(const config &cfg) -> open_port & {
+		wrap(sp_set_config(p.get(), cfg));
+		return *this;
+	}
+
+	auto get_config() const noexcept -> config {
+		struct config c {};
+		wrap(sp_get_config(p.get(), c));
+		return c;
+	}
+
+	// throws sys_exception if the termios settings are refused, a low
+	// latency flag the driver does not support is only logged.
+	// linux only, elsewhere it does nothing
+	auto tune(const read_strategy &s) -> open_port &;
+
+	// blocks until at least one byte is available or timeout_ms expires,
+	// then returns whatever is ready (up to dest.size()). 0 on timeout
+	auto read_some(std::span<char> dest, unsigned timeout_ms) -> size_t {
+		return size_t(wrap(sp_blocking_read_next(p.get(), dest.data(),
+												 dest.size(), timeout_ms)));
+	}
+
+	operator const sp_port *() const { return p.get(); }
+	operator sp_port *() { return p.get(); }
+};
+
+auto get_ports() -> std::vector<port>;
@@ -0,0 +1,53 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+// bounded lock-free ring for exactly one producer thread and one consumer
+// thread. head is only written by the consumer, tail only by the producer
+template <typename T, size_t Capacity> class spsc_ring {
+	static_assert(std::has_single_bit(Capacity),
+				  "Capacity must be a power of two");
+	static constexpr auto mask = Capacity - 1;
+
+	std::array<T, Capacity> buf{};
+	alignas(64) std::atomic<size_t> head{0};
+	alignas(64) std::atomic<size_t> tail{0};
+
+  public:
+	// producer side. false if the ring is full (the element is dropped)
+	auto push(const T &v) -> bool {
+		const auto t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == Capacity) {
+			return false;
+		}
+		buf[t & mask] = v;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer side. calls f on every element available (at most budget of
+	// them) and releases the slots in one go. returns how many were consumed
+	template <typename F>
+	auto drain(F &&f, size_t budget = std::numeric_limits<size_t>::max())
+		-> size_t {
+		const auto h = head.load(std::memory_order_relaxed);
+		const auto available = tail.load(std::memory_order_acquire) - h;
+		const auto n = available < budget ? available : budget;
+		for (auto i = h; i != h + n; ++i) {
+			f(std::as_const(buf[i & mask]));
+		}
+		head.store(h + n, std::memory_order_release);
+		return n;
+	}
+
+	auto size() const -> size_t {
+		return tail.load(std::memory_order_acquire) -
+			   head.load(std::memory_order_acquire);
+	}
+	auto empty() const -> bool { return size() == 0; }
+	static constexpr auto capacity() -> size_t { return Capacity; }
+};
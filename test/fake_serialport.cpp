@@ -0,0 +1,191 @@
+// the part of libserialport the application uses, on plain file
+// descriptors. the real library refuses pseudo terminals (no sysfs entry,
+// no modem lines), with this one the tests open them by name and drive the
+// real port, line_getter and device_samples code through them
+
+extern "C" {
+#include "libserialport.h"
+}
+
+#include "fake_serialport.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+struct sp_port {
+	std::string name;
+	int fd = -1;
+	int baudrate = 0;
+};
+
+struct sp_port_config {
+	int baudrate = 0;
+};
+
+static auto fail() -> sp_return { return SP_ERR_FAIL; }
+
+// listed from the discovery thread, set from the test one
+static auto listed_mutex = std::mutex{};
+static auto listed = std::vector<std::string>{};
+
+void list_ports(std::vector<std::string> names) {
+	auto lock = std::lock_guard{listed_mutex};
+	listed = std::move(names);
+}
+
+extern "C" {
+
+auto sp_get_port_by_name(const char *portname, sp_port **port_ptr)
+	-> sp_return {
+	if (!portname || !port_ptr) {
+		return SP_ERR_ARG;
+	}
+	*port_ptr = new sp_port{.name = portname};
+	return SP_OK;
+}
+
+void sp_free_port(sp_port *port) { delete port; }
+
+auto sp_list_ports(sp_port ***list_ptr) -> sp_return {
+	auto lock = std::lock_guard{listed_mutex};
+	*list_ptr = new sp_port *[listed.size() + 1] {};
+	for (auto i = size_t{0}; i < listed.size(); ++i) {
+		(*list_ptr)[i] = new sp_port{.name = listed[i]};
+	}
+	return SP_OK;
+}
+
+auto sp_copy_port(const sp_port *port, sp_port **copy_ptr) -> sp_return {
+	if (!port || !copy_ptr) {
+		return SP_ERR_ARG;
+	}
+	*copy_ptr = new sp_port{.name = port->name};
+	return SP_OK;
+}
+
+void sp_free_port_list(sp_port **ports) {
+	for (auto p = ports; *p; ++p) {
+		delete *p;
+	}
+	delete[] ports;
+}
+
+auto sp_open(sp_port *port, sp_mode) -> sp_return {
+	port->fd = open(port->name.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+	return port->fd < 0 ? fail() : SP_OK;
+}
+
+auto sp_close(sp_port *port) -> sp_return {
+	if (port->fd < 0) {
+		return SP_ERR_ARG;
+	}
+	close(port->fd);
+	port->fd = -1;
+	return SP_OK;
+}
+
+auto sp_get_port_name(const sp_port *port) -> char * {
+	return const_cast<char *>(port->name.c_str());
+}
+
+auto sp_get_port_description(const sp_port *) -> char * {
+	return const_cast<char *>("fake");
+}
+
+auto sp_get_port_handle(const sp_port *port, void *result_ptr) -> sp_return {
+	if (port->fd < 0) {
+		return SP_ERR_ARG;
+	}
+	*static_cast<int *>(result_ptr) = port->fd;
+	return SP_OK;
+}
+
+auto sp_new_config(sp_port_config **config_ptr) -> sp_return {
+	*config_ptr = new sp_port_config{};
+	return SP_OK;
+}
+
+void sp_free_config(sp_port_config *config) { delete config; }
+
+auto sp_get_config(sp_port *port, sp_port_config *config) -> sp_return {
+	config->baudrate = port->baudrate;
+	return SP_OK;
+}
+
+auto sp_set_config(sp_port *port, const sp_port_config *config)
+	-> sp_return {
+	if (port->fd < 0) {
+		return SP_ERR_ARG;
+	}
+	port->baudrate = config->baudrate;
+	return SP_OK;
+}
+
+auto sp_set_config_baudrate(sp_port_config *config, int baudrate)
+	-> sp_return {
+	config->baudrate = baudrate;
+	return SP_OK;
+}
+
+// the line settings mean nothing to a pseudo terminal
+auto sp_set_config_bits(sp_port_config *, int) -> sp_return { return SP_OK; }
+auto sp_set_config_parity(sp_port_config *, sp_parity) -> sp_return {
+	return SP_OK;
+}
+auto sp_set_config_stopbits(sp_port_config *, int) -> sp_return {
+	return SP_OK;
+}
+auto sp_set_config_rts(sp_port_config *, sp_rts) -> sp_return { return SP_OK; }
+auto sp_set_config_cts(sp_port_config *, sp_cts) -> sp_return { return SP_OK; }
+auto sp_set_config_dtr(sp_port_config *, sp_dtr) -> sp_return { return SP_OK; }
+auto sp_set_config_dsr(sp_port_config *, sp_dsr) -> sp_return { return SP_OK; }
+auto sp_set_config_xon_xoff(sp_port_config *, sp_xonxoff) -> sp_return {
+	return SP_OK;
+}
+auto sp_set_config_flowcontrol(sp_port_config *, sp_flowcontrol)
+	-> sp_return {
+	return SP_OK;
+}
+
+auto sp_nonblocking_read(sp_port *port, void *buf, size_t count)
+	-> sp_return {
+	const auto n = read(port->fd, buf, count);
+	if (n < 0) {
+		return errno == EAGAIN ? SP_OK : fail();
+	}
+	return sp_return(n);
+}
+
+auto sp_blocking_read_next(sp_port *port, void *buf, size_t count,
+						   unsigned int timeout_ms) -> sp_return {
+	auto pfd = pollfd{.fd = port->fd, .events = POLLIN, .revents = 0};
+	const auto ready = poll(&pfd, 1, int(timeout_ms));
+	if (ready < 0) {
+		return fail();
+	}
+	return ready == 0 ? SP_OK : sp_nonblocking_read(port, buf, count);
+}
+
+auto sp_flush(sp_port *port, sp_buffer buffers) -> sp_return {
+	const auto which = buffers == SP_BUF_BOTH	 ? TCIOFLUSH
+					   : buffers == SP_BUF_INPUT ? TCIFLUSH
+												 : TCOFLUSH;
+	return tcflush(port->fd, which) < 0 ? fail() : SP_OK;
+}
+
+auto sp_last_error_code() -> int { return errno; }
+
+auto sp_last_error_message() -> char * { return strdup(strerror(errno)); }
+
+void sp_free_error_message(char *message) { std::free(message); }
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// the ports the fake sp_list_ports gives from now on, none to begin with
+void list_ports(std::vector<std::string> names);
@@ -0,0 +1,202 @@
+#include <catch2/catch.hpp>
+
+#include "frame.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+static auto sample_imu(uint32_t ts) -> imu {
+	return {.ts = ts,
+			.acc = {int16_t(ts), -2, 3},
+			.gyro = {-4, 5, int16_t(-int(ts % 1000))}};
+}
+
+static auto sample_gps(uint32_t ts) -> gps_hybrid {
+	return {.ts = ts,
+			.pos = {.lat = {.deg = 41, .min = 54, .decimal = 829100},
+					.latdir = lat_dir::S,
+					.lon = {.deg = 12, .min = 30, .decimal = 96900},
+					.londir = lon_dir::W},
+			.speed_kmh = 410,
+			.heading = 212830,
+			.altitude_mm = -210400,
+			.hdop = 1460};
+}
+
+static void require_same(const imu &a, const imu &b) {
+	REQUIRE(a.ts == b.ts);
+	REQUIRE(a.acc == b.acc);
+	REQUIRE(a.gyro == b.gyro);
+}
+
+static void require_same(const gps_hybrid &a, const gps_hybrid &b) {
+	REQUIRE(a.ts == b.ts);
+	REQUIRE(a.pos.lat.deg == b.pos.lat.deg);
+	REQUIRE(a.pos.lat.min == b.pos.lat.min);
+	REQUIRE(a.pos.lat.decimal == b.pos.lat.decimal);
+	REQUIRE(a.pos.latdir == b.pos.latdir);
+	REQUIRE(a.pos.lon.deg == b.pos.lon.deg);
+	REQUIRE(a.pos.lon.min == b.pos.lon.min);
+	REQUIRE(a.pos.lon.decimal == b.pos.lon.decimal);
+	REQUIRE(a.pos.londir == b.pos.londir);
+	REQUIRE(a.speed_kmh == b.speed_kmh);
+	REQUIRE(a.heading == b.heading);
+	REQUIRE(a.altitude_mm == b.altitude_mm);
+	REQUIRE(a.hdop == b.hdop);
+}
+
+static void require_same(const record &a, const record &b) {
+	REQUIRE(a.index() == b.index());
+	std::visit(
+		[&](const auto &x) {
+			require_same(x, std::get<std::decay_t<decltype(x)>>(b));
+		},
+		a);
+}
+
+// every record of bytes, with the scan that found them
+static auto decode_all(std::span<const char> bytes)
+	-> std::pair<std::vector<record>, frame_scan> {
+	auto out = std::vector<record>{};
+	const auto scan = decode_frames(
+		bytes, [&](const record &r) { out.push_back(r); },
+		std::numeric_limits<size_t>::max());
+	return {out, scan};
+}
+
+static void append(std::vector<char> &to, std::span<const char> bytes) {
+	to.insert(to.end(), bytes.begin(), bytes.end());
+}
+
+TEST_CASE("crc16 is CCITT with 0xFFFF init", "[frame]") {
+	const auto check = std::string_view{"123456789"};
+	CHECK(crc16(check) == 0x29B1);
+	CHECK(crc16({}) == 0xFFFF);
+}
+
+TEST_CASE("frames round trip", "[frame]") {
+	for (const auto &r : {record{sample_imu(123456)},
+						  record{sample_gps(193035)}}) {
+		const auto bytes = encode_frame(r);
+		CHECK(uint8_t(bytes[0]) == frame_sync[0]);
+		CHECK(uint8_t(bytes[1]) == frame_sync[1]);
+		CHECK(bytes.size() == frame_overhead + size_t(uint8_t(bytes[3])));
+
+		const auto p = parse_frame(bytes);
+		REQUIRE(p.status == frame_status::ok);
+		CHECK(p.size == bytes.size());
+		REQUIRE(p.rec);
+		require_same(*p.rec, r);
+	}
+}
+
+TEST_CASE("a corrupted frame is rejected and skipped", "[frame]") {
+	const auto good = encode_frame(sample_imu(1));
+	// every byte after the sync word is covered by the crc or is the crc
+	for (auto i = size_t{2}; i < good.size(); ++i) {
+		INFO("byte " << i);
+		auto bad = good;
+		bad[i] = char(bad[i] ^ 0x10);
+		CHECK(parse_frame(bad).status == frame_status::bad);
+
+		auto stream = bad;
+		append(stream, encode_frame(sample_imu(2)));
+		const auto [recs, scan] = decode_all(stream);
+		REQUIRE(recs.size() == 1);
+		require_same(recs[0], record{sample_imu(2)});
+		CHECK(scan.errors >= 1);
+		CHECK(scan.consumed == stream.size());
+	}
+}
+
+TEST_CASE("a frame split across reads is decoded once complete",
+		  "[frame]") {
+	const auto bytes = encode_frame(sample_gps(10));
+	for (auto cut = size_t{0}; cut < bytes.size(); ++cut) {
+		INFO("cut at " << cut);
+		const auto head = std::span(bytes).first(cut);
+		CHECK(parse_frame(head).status == frame_status::need_more);
+		const auto [recs, scan] = decode_all(head);
+		CHECK(recs.empty());
+		// nothing of the partial frame is consumed
+		CHECK(scan.consumed == 0);
+	}
+	const auto [recs, scan] = decode_all(bytes);
+	REQUIRE(recs.size() == 1);
+	CHECK(scan.consumed == bytes.size());
+}
+
+TEST_CASE("the decoder resynchronizes after garbage", "[frame]") {
+	auto rng = std::mt19937{3};
+	auto byte = std::uniform_int_distribution<int>{0, 255};
+	auto stream = std::vector<char>{};
+	auto sent = std::vector<record>{};
+	for (auto i = 0u; i < 200; ++i) {
+		// noise, with false sync words in it now and then
+		for (auto k = 0, n = byte(rng) % 40; k < n; ++k) {
+			stream.push_back(char(byte(rng)));
+		}
+		if (i % 7 == 0) {
+			append(stream, std::vector<char>{char(0xA5), char(0x5A), 1, 16});
+		}
+		if (i % 11 == 0) {
+			append(stream, std::string_view("imu;1;2;3;4;5;6;7\n"));
+		}
+		sent.push_back(i % 3 == 0 ? record{sample_gps(i)}
+								  : record{sample_imu(i)});
+		append(stream, encode_frame(sent.back()));
+	}
+
+	const auto [recs, scan] = decode_all(stream);
+	REQUIRE(recs.size() == sent.size());
+	for (auto i = size_t{0}; i < sent.size(); ++i) {
+		require_same(recs[i], sent[i]);
+	}
+	CHECK(scan.frames == sent.size());
+	CHECK(scan.skipped > 0);
+	CHECK(scan.consumed == stream.size());
+}
+
+TEST_CASE("the budget stops the decoder between frames", "[frame]") {
+	auto stream = std::vector<char>{};
+	for (auto i = 0u; i < 10; ++i) {
+		append(stream, encode_frame(sample_imu(i)));
+	}
+	auto seen = size_t{0};
+	const auto scan = decode_frames(
+		std::span<const char>(stream), [&](const record &) { ++seen; }, 4);
+	CHECK(seen == 4);
+	CHECK(scan.frames == 4);
+	CHECK(scan.consumed == 4 * encode_frame(sample_imu(0)).size());
+}
+
+TEST_CASE("the protocol is told from a window of bytes", "[frame]") {
+	auto text = std::string{};
+	auto binary = std::vector<char>{};
+	for (auto i = 0u; i < 5; ++i) {
+		text += "imu;" + std::to_string(i) + ";1;2;3;4;5;6\n";
+		append(binary, encode_frame(sample_imu(i)));
+	}
+	auto noise = std::vector<char>(2048);
+	auto rng = std::mt19937{5};
+	for (auto &c : noise) {
+		c = char(rng());
+	}
+
+	CHECK(detect_protocol(std::span(text.data(), text.size())) ==
+		  protocol::text);
+	CHECK(detect_protocol(binary) == protocol::binary);
+	CHECK(detect_protocol(noise) == protocol::autodetect);
+	// too few records either way
+	CHECK(detect_protocol(std::span(text.data(), 40)) == protocol::autodetect);
+
+	const auto s = score_protocols(noise);
+	CHECK(s.frames == 0);
+	CHECK(s.lines == 0);
+}
@@ -0,0 +1,168 @@
+#include <catch2/catch.hpp>
+
+#include "gps_index.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <random>
+#include <vector>
+
+// the grid against a linear scan over the same fixes
+
+static auto random_fixes(size_t n) -> std::vector<gps_index::fix> {
+	auto rng = std::mt19937{15};
+	// a wide area around the origin, so cells have negative coordinates
+	// too, and a dense cluster where cells hold many fixes
+	auto wide = std::uniform_real_distribution<double>{-0.02, 0.02};
+	auto dense = std::normal_distribution<double>{0.005, 0.0003};
+	auto out = std::vector<gps_index::fix>(n);
+	for (auto i = size_t{0}; i < n; ++i) {
+		const auto clustered = i % 3 == 0;
+		const auto x = clustered ? dense(rng) : wide(rng);
+		const auto y = clustered ? dense(rng) : wide(rng);
+		const auto k = double(i);
+		out[i] = {.x = x, .y = y, .n = k, .pos = {}, .t = 0.5 * k};
+	}
+	return out;
+}
+
+static auto dist2(const gps_index::fix &f, double x, double y) {
+	return (f.x - x) * (f.x - x) + (f.y - y) * (f.y - y);
+}
+
+static auto scan_nearest(const std::vector<gps_index::fix> &fs, double x,
+						 double y, double radius) -> std::optional<double> {
+	auto best = std::optional<double>{};
+	for (const auto &f : fs) {
+		const auto d = dist2(f, x, y);
+		if (d <= radius * radius && (!best || d < *best)) {
+			best = d;
+		}
+	}
+	return best;
+}
+
+static auto scan_covered(const std::vector<gps_index::fix> &fs,
+						 const gps_track::bbox &b)
+	-> std::optional<time_span> {
+	auto span = std::optional<time_span>{};
+	for (const auto &f : fs) {
+		if (f.x >= b.x0 && f.x <= b.x1 && f.y >= b.y0 && f.y <= b.y1) {
+			span = span ? time_span{std::min(span->from, f.t),
+									std::max(span->to, f.t)}
+						: time_span{f.t, f.t};
+		}
+	}
+	return span;
+}
+
+// random queries of both kinds, from inside the fixes to well outside
+static void check_queries(const gps_index &idx,
+						  const std::vector<gps_index::fix> &fs) {
+	auto rng = std::mt19937{51};
+	auto at = std::uniform_real_distribution<double>{-0.03, 0.03};
+	auto size = std::uniform_real_distribution<double>{0, 0.004};
+	for (auto q = 0; q < 1'000; ++q) {
+		const auto x = at(rng), y = at(rng), r = size(rng);
+		const auto got = idx.nearest(x, y, r);
+		const auto want = scan_nearest(fs, x, y, r);
+		REQUIRE(got.has_value() == want.has_value());
+		if (got) {
+			// ties may pick another fix, never a farther one
+			REQUIRE(dist2(*got, x, y) == *want);
+		}
+
+		const auto w = size(rng), h = size(rng);
+		const auto box = gps_track::bbox{x, y, x + w, y + h};
+		const auto span = idx.time_covered(box);
+		const auto expected = scan_covered(fs, box);
+		REQUIRE(span.has_value() == expected.has_value());
+		if (span) {
+			REQUIRE(span->from == expected->from);
+			REQUIRE(span->to == expected->to);
+		}
+	}
+}
+
+TEST_CASE("queries match a linear scan", "[gps_index]") {
+	const auto fs = random_fixes(200'000);
+	auto idx = gps_index{};
+	for (const auto &f : fs) {
+		idx.add(f);
+	}
+	CHECK(idx.size() == fs.size());
+	check_queries(idx, fs);
+
+	// a box larger than the occupied area walks the occupied cells
+	const auto all = idx.time_covered({-1, -1, 1, 1});
+	REQUIRE(all);
+	CHECK(all->from == 0);
+	CHECK(all->to == 0.5 * double(fs.size() - 1));
+}
+
+TEST_CASE("queries after eviction match a linear scan", "[gps_index]") {
+	auto fs = random_fixes(50'000);
+	auto idx = gps_index{};
+	for (const auto &f : fs) {
+		idx.add(f);
+	}
+	idx.drop_before(30'000.5);
+	fs.erase(fs.begin(), fs.begin() + 30'001);
+	CHECK(idx.size() == fs.size());
+	check_queries(idx, fs);
+
+	idx.drop_before(1e9);
+	CHECK(idx.size() == 0);
+	CHECK(!idx.nearest(0.005, 0.005, 1));
+	CHECK(!idx.time_covered({-1, -1, 1, 1}));
+}
+
+TEST_CASE("empty cells and out of bounds queries find nothing",
+		  "[gps_index]") {
+	// unit cells, coordinates exact in binary
+	auto idx = gps_index{1};
+	CHECK(!idx.nearest(0, 0, 1));
+	CHECK(!idx.time_covered({-1, -1, 1, 1}));
+
+	idx.add({.x = 1.5, .y = 1.5, .n = 0, .pos = {}, .t = 1});
+	idx.add({.x = -3.5, .y = 2.5, .n = 1, .pos = {}, .t = 2});
+
+	// empty cells between the two fixes, the radius short of both
+	CHECK(!idx.nearest(-1, 0.5, 0.5));
+	CHECK(!idx.time_covered({-2, 0, -1, 1}));
+	// a box in the cell of a fix but not around it
+	CHECK(!idx.time_covered({1, 1, 1.25, 1.25}));
+	// far from everything, and on the far side of the coordinate range
+	CHECK(!idx.nearest(100, 100, 10));
+	CHECK(!idx.nearest(-1e9, 1e9, 1));
+	CHECK(!idx.time_covered({50, 50, 60, 60}));
+	CHECK(!idx.time_covered({-60, -60, -50, -50}));
+
+	// the radius is inclusive
+	const auto f = idx.nearest(1.5, 0.5, 1);
+	REQUIRE(f);
+	CHECK(f->n == 0);
+	const auto g = idx.nearest(-3, 2, 1);
+	REQUIRE(g);
+	CHECK(g->n == 1);
+	const auto both = idx.time_covered({-10, -10, 10, 10});
+	REQUIRE(both);
+	CHECK(both->from == 1);
+	CHECK(both->to == 2);
+}
+
+TEST_CASE("the fixes come back in the order they were added",
+		  "[gps_index]") {
+	const auto fs = random_fixes(10'000);
+	auto idx = gps_index{};
+	for (const auto &f : fs) {
+		idx.add(f);
+	}
+	idx.drop_before(2'500);
+	const auto all = idx.in_order();
+	REQUIRE(all.size() == 7'500);
+	for (auto i = size_t{0}; i < all.size(); ++i) {
+		REQUIRE(all[i].n == fs[2'500 + i].n);
+		REQUIRE(all[i].x == fs[2'500 + i].x);
+	}
+}
@@ -0,0 +1,109 @@
+#include <catch2/catch.hpp>
+
+#include "line_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+
+// the lines fed to the buffer, numbered so a split at the wrong place shows
+static auto numbered(size_t i) -> std::string {
+	return "line" + std::to_string(i) + std::string(i % 11, 'x');
+}
+
+static auto feed(line_buffer &b, std::string_view bytes, size_t min_free) {
+	const auto dest = b.writable(min_free);
+	const auto n = std::min(dest.size(), bytes.size());
+	std::memcpy(dest.data(), bytes.data(), n);
+	b.commit(n);
+	return n;
+}
+
+TEST_CASE("lines split at every newline", "[line_buffer]") {
+	auto b = line_buffer{};
+	feed(b, "imu;1\n\ngps;2\nunterminated", 64);
+	CHECK(b.next_line() == "imu;1");
+	CHECK(b.next_line() == "");
+	CHECK(b.next_line() == "gps;2");
+	CHECK(!b.next_line());
+	feed(b, "\n", 64);
+	CHECK(b.next_line() == "unterminated");
+	CHECK(!b.next_line());
+	CHECK(b.size() == 0);
+}
+
+TEST_CASE("a drain stopped mid block survives the compaction",
+		  "[line_buffer]") {
+	// seven short lines in the first 64 byte block, three of them drained,
+	// then a write that needs the head back
+	auto b = line_buffer{128};
+	auto sent = std::string{};
+	for (auto i = size_t{1}; i <= 7; ++i) {
+		sent += "line" + std::to_string(i) + "\n";
+	}
+	feed(b, sent, 64);
+	CHECK(b.next_line() == "line1");
+	CHECK(b.next_line() == "line2");
+	CHECK(b.next_line() == "line3");
+
+	auto more = std::string{};
+	for (auto i = size_t{8}; i <= 30; ++i) {
+		more += "line" + std::to_string(i) + "\n";
+	}
+	auto at = size_t{0};
+	auto expected = size_t{4};
+	while (at < more.size()) {
+		at += feed(b, std::string_view(more).substr(at), 100);
+		while (const auto line = b.next_line()) {
+			REQUIRE(*line == "line" + std::to_string(expected));
+			++expected;
+		}
+	}
+	CHECK(expected == 31);
+}
+
+TEST_CASE("budgeted drains, compactions and block boundaries",
+		  "[line_buffer]") {
+	auto rng = std::mt19937{7};
+	auto chunk = std::uniform_int_distribution<size_t>{1, 90};
+	auto budget = std::uniform_int_distribution<size_t>{0, 4};
+
+	auto stream = std::string{};
+	for (auto i = size_t{0}; i < 5'000; ++i) {
+		stream += numbered(i) + "\n";
+	}
+
+	auto b = line_buffer{256};
+	auto at = size_t{0};
+	auto next = size_t{0};
+	while (next < 5'000) {
+		// the reader keeps up on average, the buffer never fills up
+		if (at < stream.size() && b.size() < b.capacity() / 2) {
+			const auto n = std::min(chunk(rng), stream.size() - at);
+			at += feed(b, std::string_view(stream).substr(at, n), n);
+		}
+		// a few lines per round, or all of them once the stream is over
+		const auto lines = at < stream.size() ? budget(rng) : 5'000;
+		for (auto k = size_t{0}; k < lines; ++k) {
+			const auto line = b.next_line();
+			if (!line) {
+				break;
+			}
+			REQUIRE(*line == numbered(next));
+			++next;
+		}
+	}
+	CHECK(!b.next_line());
+	CHECK(b.discarded() == 0);
+}
+
+TEST_CASE("a line longer than the buffer is discarded", "[line_buffer]") {
+	auto b = line_buffer{64};
+	feed(b, std::string(64, 'a'), 64);
+	CHECK(!b.next_line());
+	feed(b, "ok\n", 64);
+	CHECK(b.discarded() == 64);
+	CHECK(b.next_line() == "ok");
+}
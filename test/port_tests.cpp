@@ -0,0 +1,388 @@
+#include <catch2/catch.hpp>
+
+#include "fake_serialport.hpp"
+#include "frame.hpp"
+#include "io_reactor.hpp"
+#include "port_discovery.hpp"
+#include "port_probe.hpp"
+#include "pty.hpp"
+#include "serial_device.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+// the port code reads the pseudo terminals through libserialport, here the
+// fake one in fake_serialport.cpp
+
+static auto open_pty(const pty &p) -> open_port {
+	sp_port *raw = nullptr;
+	REQUIRE(sp_get_port_by_name(p.name().c_str(), &raw) == SP_OK);
+	auto res = port(raw).open();
+	sp_free_port(raw);
+	return res;
+}
+
+static auto imu_line(uint32_t ts) -> std::string {
+	return "imu;" + std::to_string(ts) + ";1;2;3;4;5;6\n";
+}
+
+static auto imu_frame(uint32_t ts) -> std::string {
+	const auto f = encode_frame(imu{.ts = ts, .acc = {1, 2, 3}, .gyro = {}});
+	return {f.begin(), f.end()};
+}
+
+static auto ts_of(const record &r) -> uint32_t {
+	return std::visit([](const auto &x) { return x.ts; }, r);
+}
+
+// drains s until n records came in or a few seconds went by
+static auto collect(data_source &s, size_t n) -> std::vector<record> {
+	auto out = std::vector<record>{};
+	for (auto i = 0; i < 40 && out.size() < n; ++i) {
+		s.drain([&](const record &r) { out.push_back(r); });
+	}
+	return out;
+}
+
+TEST_CASE("a text port is detected and parsed", "[data_source]") {
+	auto p = pty{};
+	auto s = data_source{.get = line_getter(open_pty(p))};
+	for (auto i = 0u; i < 10; ++i) {
+		p.send(imu_line(i));
+	}
+	const auto recs = collect(s, 10);
+	CHECK(s.mode == protocol::text);
+	REQUIRE(recs.size() == 10);
+	for (auto i = 0u; i < 10; ++i) {
+		CHECK(ts_of(recs[i]) == i);
+	}
+}
+
+TEST_CASE("a binary port is detected through garbage and split frames",
+		  "[data_source]") {
+	auto p = pty{};
+	auto s = data_source{.get = line_getter(open_pty(p))};
+	// what the port had buffered before the device got going
+	p.send(std::string(100, '\x13'));
+	auto stream = std::string{};
+	for (auto i = 0u; i < 20; ++i) {
+		stream += imu_frame(i);
+	}
+	// the frames cut at odd places across writes
+	for (auto at = size_t{0}; at < stream.size(); at += 7) {
+		p.send(std::string_view(stream).substr(at, 7));
+	}
+
+	const auto recs = collect(s, 20);
+	CHECK(s.mode == protocol::binary);
+	REQUIRE(recs.size() == 20);
+	for (auto i = 0u; i < 20; ++i) {
+		CHECK(ts_of(recs[i]) == i);
+	}
+}
+
+TEST_CASE("frames and lines mixed on a binary port", "[data_source]") {
+	auto p = pty{};
+	auto s = data_source{.get = line_getter(open_pty(p)),
+						 .mode = protocol::binary};
+	// a few stray lines are garbage to the frame decoder, not enough to
+	// give up on the binary protocol
+	for (auto i = 0u; i < 30; ++i) {
+		p.send(imu_frame(i));
+		if (i % 5 == 0) {
+			p.send(imu_line(1000 + i));
+		}
+	}
+	const auto recs = collect(s, 30);
+	CHECK(s.mode == protocol::binary);
+	REQUIRE(recs.size() == 30);
+	for (auto i = 0u; i < 30; ++i) {
+		CHECK(ts_of(recs[i]) == i);
+	}
+}
+
+TEST_CASE("a binary port that speaks text falls back to it",
+		  "[data_source]") {
+	auto p = pty{};
+	auto s = data_source{.get = line_getter(open_pty(p)),
+						 .mode = protocol::binary};
+	// more text than the junk tolerated in binary mode
+	auto sent = size_t{0};
+	auto ts = 0u;
+	while (sent <= data_source::max_binary_junk) {
+		const auto line = imu_line(ts++);
+		p.send(line);
+		sent += line.size();
+	}
+	for (auto i = 0; i < 40 && s.mode == protocol::binary; ++i) {
+		s.drain([](const record &) {});
+	}
+	REQUIRE(s.mode != protocol::binary);
+
+	// the lines eaten as garbage are lost, the text from then on is
+	// detected and parsed in order
+	for (auto i = 0u; i < 10; ++i) {
+		p.send(imu_line(ts + i));
+	}
+	auto recs = std::vector<record>{};
+	for (auto i = 0;
+		 i < 40 && (recs.empty() || ts_of(recs.back()) != ts + 9); ++i) {
+		s.drain([&](const record &r) { recs.push_back(r); });
+	}
+	CHECK(s.mode == protocol::text);
+	REQUIRE(recs.size() >= 10);
+	for (auto i = size_t{1}; i < recs.size(); ++i) {
+		CHECK(ts_of(recs[i]) == ts_of(recs[i - 1]) + 1);
+	}
+	CHECK(ts_of(recs.back()) == ts + 9);
+}
+
+// a device read by the reactor, the way device_manager opens them on linux
+
+TEST_CASE("a device on the reactor never blocks it", "[device_samples]") {
+	auto a = pty{}, b = pty{};
+	auto r = io_reactor{};
+	auto da = device_samples(open_pty(a), protocol::text, &r);
+	auto db = device_samples(open_pty(b), protocol::text, &r);
+	REQUIRE(r.watched() == 2);
+	REQUIRE(da.src);
+	CHECK(!da.src->get.blocking);
+	CHECK(!da.reader.joinable());
+
+	// a line cut in two: the reactor reads what is there and goes on to
+	// the other port instead of waiting for the rest
+	for (auto i = 0u; i < 10; ++i) {
+		const auto line = imu_line(i);
+		a.send(line.substr(0, 5));
+		b.send(line);
+		REQUIRE(eventually([&] {
+			db.update();
+			return db.imu_samples.size() == i + 1;
+		}));
+		a.send(line.substr(5));
+	}
+	REQUIRE(eventually([&] {
+		da.update();
+		return da.imu_samples.size() == 10;
+	}));
+	for (auto i = 0u; i < 10; ++i) {
+		CHECK(da.imu_samples[i].ts == i);
+		CHECK(db.imu_samples[i].ts == i);
+	}
+	CHECK(da.shared->alive);
+}
+
+TEST_CASE("lines past the budget of a wakeup are drained by it",
+		  "[device_samples]") {
+	auto p = pty{};
+	// more lines than one drain hands out, all in the port before the
+	// first wakeup and within a single read of it (a tty read returns 4 kB
+	// at most): no data comes after them to wake the reactor again. lines
+	// that are not records count against the budget all the same
+	auto burst = std::string{};
+	for (auto i = size_t{0}; i < line_getter::default_budget + 100; ++i) {
+		burst += "?\n";
+	}
+	for (auto i = 0u; i < 10; ++i) {
+		burst += imu_line(i);
+	}
+	REQUIRE(burst.size() < 4'096);
+	p.send(burst);
+	using namespace std::chrono_literals;
+	std::this_thread::sleep_for(50ms);
+
+	auto r = io_reactor{};
+	auto d = device_samples(open_pty(p), protocol::text, &r);
+	REQUIRE(eventually([&] {
+		d.update();
+		return d.imu_samples.size() == 10;
+	}));
+	for (auto i = 0u; i < 10; ++i) {
+		CHECK(d.imu_samples[i].ts == i);
+	}
+	CHECK(d.shared->reads.get().reads == 1);
+}
+
+TEST_CASE("a device that goes away is dropped by the reactor",
+		  "[device_samples]") {
+	auto r = io_reactor{};
+	SECTION("the port hangs up") {
+		auto p = pty{};
+		auto d = device_samples(open_pty(p), protocol::text, &r);
+		p.send(imu_line(1));
+		REQUIRE(eventually([&] {
+			d.update();
+			return d.imu_samples.size() == 1;
+		}));
+		p.close_master();
+		REQUIRE(eventually([&] { return !d.shared->alive; }));
+		REQUIRE(eventually([&] { return r.watched() == 0; }));
+	}
+	SECTION("the device is removed") {
+		auto p = pty{};
+		{
+			auto d = device_samples(open_pty(p), protocol::text, &r);
+			CHECK(r.watched() == 1);
+		}
+		CHECK(r.watched() == 0);
+		// nothing reads the port any more, nothing is called back
+		p.send(imu_line(1));
+		using namespace std::chrono_literals;
+		std::this_thread::sleep_for(50ms);
+		CHECK(r.watched() == 0);
+	}
+}
+
+static auto is_open(int fd) -> bool { return fcntl(fd, F_GETFD) != -1; }
+
+TEST_CASE("an open port is closed by the last of its owners", "[port]") {
+	auto p = pty{};
+	sp_port *raw = nullptr;
+	REQUIRE(sp_get_port_by_name(p.name().c_str(), &raw) == SP_OK);
+	auto found = port(raw);
+	sp_free_port(raw);
+
+	auto fd = -1;
+	{
+		auto o = found.open();
+		REQUIRE(sp_get_port_handle(o, &fd) == SP_OK);
+		CHECK(is_open(fd));
+	}
+	// dropped without a device, as when probing it throws
+	CHECK(!is_open(fd));
+
+	auto r = io_reactor{};
+	for (auto *reactor : {&r, static_cast<io_reactor *>(nullptr)}) {
+		INFO((reactor ? "reactor" : "reader thread"));
+		// the port it came from opens again
+		auto d = std::make_unique<device_samples>(found.open(),
+												  protocol::text, reactor);
+		REQUIRE(sp_get_port_handle(d->port, &fd) == SP_OK);
+		// the ui still holds the port: it stays open without its reader
+		auto ui = d->port;
+		d.reset();
+		CHECK(r.watched() == 0);
+		CHECK(is_open(fd));
+		ui.p.reset();
+		CHECK(!is_open(fd));
+	}
+}
+
+// a pty passes the bytes through at any rate: what a probe sees is what was
+// sent, whatever the rate it listens at
+static const auto quick_probe =
+	probe_config{.bauds = {115200, 9600}, .budget_ms = 400};
+
+// the probe flushes what came in before it listens: s is sent once it does.
+// no REQUIRE off the test thread
+static auto send_later(const pty &p, std::string s) -> std::jthread {
+	return std::jthread{[&p, s = std::move(s)] {
+		std::this_thread::sleep_for(std::chrono::milliseconds{50});
+		(void)!write(p.master, s.data(), s.size());
+	}};
+}
+
+TEST_CASE("a slow port is not taken for noise", "[probe]") {
+	auto p = pty{};
+	auto o = open_pty(p);
+	SECTION("silent") {
+		const auto r = probe_port(o, quick_probe);
+		CHECK(r.proto == protocol::autodetect);
+		CHECK(r.bytes == 0);
+		CHECK(r.baud == 115200);
+		CHECK(!is_noise(r, quick_probe));
+	}
+	SECTION("a record now and then") {
+		// a 1 Hz device, too slow for the evidence a protocol needs
+		const auto sender = send_later(p, imu_line(1));
+		const auto r = probe_port(o, quick_probe);
+		CHECK(r.proto == protocol::autodetect);
+		CHECK(r.records == 1);
+		CHECK(!is_noise(r, quick_probe));
+	}
+	SECTION("a boot banner") {
+		const auto sender =
+			send_later(p, "bootloader v1.2\nstarting...\n");
+		const auto r = probe_port(o, quick_probe);
+		CHECK(r.records == 0);
+		CHECK(r.bytes > 0);
+		CHECK(!is_noise(r, quick_probe));
+	}
+	SECTION("noise") {
+		const auto sender =
+			send_later(p, std::string(quick_probe.noise, '\x13'));
+		const auto r = probe_port(o, quick_probe);
+		CHECK(r.records == 0);
+		CHECK(is_noise(r, quick_probe));
+	}
+}
+
+TEST_CASE("a probe gives up when asked to stop", "[probe]") {
+	auto p = pty{};
+	auto o = open_pty(p);
+	auto stop = std::stop_source{};
+	const auto slow = probe_config{.bauds = {115200}, .budget_ms = 60'000};
+	auto asker = std::jthread{[&] {
+		std::this_thread::sleep_for(std::chrono::milliseconds{100});
+		stop.request_stop();
+	}};
+	const auto start = std::chrono::steady_clock::now();
+	const auto r = probe_port(o, slow, stop.get_token());
+	CHECK(r.bytes == 0);
+	CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds{2});
+}
+
+// the events discovery posts until there are n of them, or a second went by
+static auto wait_events(port_discovery &d, size_t n)
+	-> std::vector<port_discovery::event> {
+	auto out = std::vector<port_discovery::event>{};
+	for (auto i = 0; i < 100 && out.size() < n; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds{10});
+		for (auto &e : d.take()) {
+			out.push_back(std::move(e));
+		}
+	}
+	return out;
+}
+
+TEST_CASE("a forgotten port is opened again while it is listed",
+		  "[discovery]") {
+	const auto name = std::string{"/dev/ttyFAKE0"};
+	list_ports({name});
+	auto opens = std::atomic<int>{0};
+	auto d = port_discovery{
+		[&](port, std::stop_token) {
+			++opens;
+			return std::unique_ptr<device_samples>{};
+		},
+		{.rescan_ms = 20, .settle_ms = 20, .uevent_rescan_ms = 20}};
+	const auto opened = [&](const auto &events) {
+		return events.size() == 1 &&
+			   std::holds_alternative<port_discovery::opened>(events[0]) &&
+			   std::get<port_discovery::opened>(events[0]).name == name;
+	};
+	CHECK(opened(wait_events(d, 1)));
+
+	// rescans leave an open port alone
+	std::this_thread::sleep_for(std::chrono::milliseconds{100});
+	CHECK(d.take().empty());
+	CHECK(opens == 1);
+
+	// its device stopped and was dropped
+	d.forget(name);
+	CHECK(opened(wait_events(d, 1)));
+	CHECK(opens == 2);
+
+	// and this time the port is gone as well: nothing left to report
+	list_ports({});
+	d.forget(name);
+	std::this_thread::sleep_for(std::chrono::milliseconds{100});
+	CHECK(d.take().empty());
+	CHECK(opens == 2);
+}
@@ -0,0 +1,128 @@
+#include <catch2/catch.hpp>
+
+#include "gps.hpp"
+#include "gps_track.hpp"
+
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <utility>
+#include <vector>
+
+// the scalar conversion is the reference for the batch kernel
+
+static auto random_positions(size_t n) {
+	auto rng = std::mt19937{42};
+	auto lat = std::uniform_real_distribution<double>{-85, 85};
+	auto lon = std::uniform_real_distribution<double>{-180, 180};
+	auto ps = std::vector<DegPos>(n);
+	for (auto &p : ps) {
+		p = {lat(rng), lon(rng)};
+	}
+	return ps;
+}
+
+TEST_CASE("batch projection matches the scalar one", "[projection]") {
+	// sizes around the vector widths exercise the partial blocks
+	for (const auto n : {size_t{1}, size_t{3}, size_t{7}, size_t{1003}}) {
+		const auto ps = random_positions(n);
+		auto out = std::vector<MercatorePos>(n);
+		project(ps, out);
+		for (auto i = size_t{0}; i < n; ++i) {
+			const auto ref = MercatorePos(ps[i]);
+			REQUIRE(out[i].x == ref.x);
+			REQUIRE(std::abs(out[i].y - ref.y) <= 1e-11);
+		}
+	}
+}
+
+TEST_CASE("batch projection error bound over the range", "[projection]") {
+	auto ps = random_positions(100'000);
+	ps.push_back({85, 0});
+	ps.push_back({-85, 0});
+	ps.push_back({0, 0});
+	ps.push_back({1e-9, 0});
+	auto out = std::vector<MercatorePos>(ps.size());
+	project(ps, out);
+	auto worst = 0.;
+	for (auto i = size_t{0}; i < ps.size(); ++i) {
+		worst = std::max(worst, std::abs(out[i].y - MercatorePos(ps[i]).y));
+	}
+	REQUIRE(worst <= 1e-11);
+	REQUIRE(out[ps.size() - 2].y == 0);
+}
+
+TEST_CASE("batch projection clamps the poles", "[projection]") {
+	const auto ps = std::vector<DegPos>{{90, 0}, {-90, 0}};
+	auto out = std::vector<MercatorePos>(2);
+	project(ps, out);
+	const auto ref = MercatorePos(DegPos{89.9, 0});
+	// 1 - sin(lat) is tiny there, the bound is looser than below 85
+	REQUIRE(std::isfinite(out[0].y));
+	REQUIRE(std::abs(out[0].y - ref.y) <= 1e-7);
+	REQUIRE(out[1].y == Approx(-out[0].y));
+}
+
+TEST_CASE("batch projection stops at the shorter span", "[projection]") {
+	const auto ps = random_positions(8);
+	auto out = std::vector<MercatorePos>(5, MercatorePos{-1, -1});
+	project(ps, out);
+	REQUIRE(out[4].x == ps[4].lon);
+	project(std::span<const DegPos>{}, out);
+	REQUIRE(out[0].x == ps[0].lon);
+}
+
+// east along the parallel and north along the meridian of a small step,
+// from the radii of curvature of the ellipsoid at the origin
+static auto ellipsoid_radii(double lat) {
+	constexpr auto a = 6378137., e2 = 6.69437999014e-3;
+	const auto s = std::sin(lat * std::numbers::pi / 180);
+	const auto w = 1 - e2 * s * s;
+	const auto prime_vertical = a / std::sqrt(w);
+	const auto meridian = a * (1 - e2) / (w * std::sqrt(w));
+	return std::pair{prime_vertical, meridian};
+}
+
+TEST_CASE("local plane offsets in meters", "[projection]") {
+	constexpr auto step = 1e-3; // degrees, ~100 m
+	constexpr auto rad = step * std::numbers::pi / 180;
+	for (const auto origin : {DegPos{0, 0}, DegPos{45, 10},
+							  DegPos{-33.9, 151.2}, DegPos{60, -120}}) {
+		INFO(origin.lat << ", " << origin.lon);
+		const auto plane = local_tangent_plane{origin};
+		const auto o = plane.project(origin);
+		REQUIRE(o.east == 0);
+		REQUIRE(o.north == 0);
+
+		const auto [n, m] = ellipsoid_radii(origin.lat);
+		const auto cos_lat = std::cos(origin.lat * std::numbers::pi / 180);
+		const auto e = plane.project({origin.lat, origin.lon + step});
+		REQUIRE(e.east == Approx(n * cos_lat * rad).margin(1e-6));
+		// the parallel curves away from the plane, half a millimeter
+		REQUIRE(std::abs(e.north) < 1e-3);
+		const auto w = plane.project({origin.lat, origin.lon - step});
+		REQUIRE(w.east == Approx(-e.east).margin(1e-6));
+
+		const auto no = plane.project({origin.lat + step, origin.lon});
+		REQUIRE(no.north == Approx(m * rad).margin(1e-3));
+		REQUIRE(std::abs(no.east) < 1e-6);
+	}
+}
+
+TEST_CASE("a local track is in meters from its first fix", "[projection]") {
+	auto track = gps_track{gps_track::projection::local};
+	CHECK(track.meter() == 1);
+	const auto fixes = std::vector<DegPos>{
+		{45, 10}, {45, 10}, {45, 10.001}, {45.001, 10.001}};
+	auto rows = std::vector<gps_track::level::row>{};
+	track.push(fixes,
+			   [&](const DegPos &, const auto &r) { rows.push_back(r); });
+	// the repeated fix is not stored
+	REQUIRE(rows.size() == 3);
+	CHECK(rows[0][gps_track::x] == 0);
+	CHECK(rows[0][gps_track::y] == 0);
+	CHECK(rows[1][gps_track::x] == Approx(78.8468).margin(1e-3));
+	CHECK(rows[1][gps_track::y] == Approx(0).margin(1e-3));
+	CHECK(rows[2][gps_track::y] == Approx(111.1318).margin(1e-2));
+	CHECK(rows[2][gps_track::n] == 2);
+}
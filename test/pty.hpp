@@ -0,0 +1,59 @@
+#pragma once
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <fcntl.h>
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+
+// pseudo terminals stand in for the serial ports: the test writes on the
+// master side, the code under test reads the slave side like it would a
+// tty, through the fd or by name
+struct pty {
+	int master = -1;
+	int slave = -1;
+
+	pty() {
+		REQUIRE(openpty(&master, &slave, nullptr, nullptr, nullptr) == 0);
+		auto t = termios{};
+		tcgetattr(slave, &t);
+		cfmakeraw(&t);
+		tcsetattr(slave, TCSANOW, &t);
+		fcntl(slave, F_SETFL, fcntl(slave, F_GETFL) | O_NONBLOCK);
+	}
+	pty(const pty &) = delete;
+	~pty() {
+		close_master();
+		close(slave);
+	}
+
+	auto name() const -> std::string { return ttyname(slave); }
+
+	// the slave side buffers some 20 kB, more blocks until it is read
+	void send(std::string_view s) const {
+		REQUIRE(write(master, s.data(), s.size()) == ssize_t(s.size()));
+	}
+	void close_master() {
+		if (master >= 0) {
+			close(master);
+			master = -1;
+		}
+	}
+};
+
+// polls cond for up to a couple of seconds
+template <typename F> auto eventually(F &&cond) -> bool {
+	using namespace std::chrono_literals;
+	for (auto i = 0; i < 200; ++i) {
+		if (cond()) {
+			return true;
+		}
+		std::this_thread::sleep_for(10ms);
+	}
+	return cond();
+}
@@ -0,0 +1,173 @@
+#include <catch2/catch.hpp>
+
+#include "io_reactor.hpp"
+#include "line_buffer.hpp"
+#include "records.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include <fcntl.h>
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+
+// pseudo terminals stand in for the serial ports: the test writes on the
+// master side, the reactor watches the slave side like it would a tty
+
+struct pty {
+	int master = -1;
+	int slave = -1;
+
+	pty() {
+		REQUIRE(openpty(&master, &slave, nullptr, nullptr, nullptr) == 0);
+		auto t = termios{};
+		tcgetattr(slave, &t);
+		cfmakeraw(&t);
+		tcsetattr(slave, TCSANOW, &t);
+		fcntl(slave, F_SETFL, fcntl(slave, F_GETFL) | O_NONBLOCK);
+	}
+	pty(const pty &) = delete;
+	~pty() {
+		close_master();
+		close(slave);
+	}
+
+	void send(std::string_view s) const {
+		REQUIRE(write(master, s.data(), s.size()) == ssize_t(s.size()));
+	}
+	void close_master() {
+		if (master >= 0) {
+			close(master);
+			master = -1;
+		}
+	}
+};
+
+// polls cond for up to a couple of seconds
+template <typename F> static auto eventually(F &&cond) -> bool {
+	using namespace std::chrono_literals;
+	for (auto i = 0; i < 200; ++i) {
+		if (cond()) {
+			return true;
+		}
+		std::this_thread::sleep_for(10ms);
+	}
+	return cond();
+}
+
+// what a port does on the reactor thread: read all it can, split in lines,
+// decode the records
+struct line_port {
+	explicit line_port(int f) : fd{f} {}
+
+	int fd;
+	line_buffer buf{};
+	std::atomic<size_t> imus{0};
+	std::atomic<size_t> lines{0};
+
+	auto on_readable() -> bool {
+		const auto dest = buf.writable(1024);
+		const auto n = read(fd, dest.data(), dest.size());
+		buf.commit(n > 0 ? size_t(n) : 0);
+		while (const auto line = buf.next_line()) {
+			++lines;
+			if (const auto r = records::parse(*line);
+				r && std::holds_alternative<imu>(*r)) {
+				++imus;
+			}
+		}
+		return true;
+	}
+};
+
+TEST_CASE("a port wakes the reactor only when it has data", "[reactor]") {
+	auto p = pty{};
+	auto calls = std::atomic<size_t>{0};
+	auto r = io_reactor{};
+	r.watch(p.slave, [&](bool) {
+		++calls;
+		auto b = std::array<char, 64>{};
+		while (read(p.slave, b.data(), b.size()) > 0) {
+		}
+		return true;
+	});
+
+	using namespace std::chrono_literals;
+	std::this_thread::sleep_for(50ms);
+	CHECK(calls == 0);
+
+	p.send("imu;1;2;3;4;5;6;7\n");
+	REQUIRE(eventually([&] { return calls > 0; }));
+	// everything was read, the handler is not called over and over
+	const auto after = calls.load();
+	std::this_thread::sleep_for(50ms);
+	CHECK(calls == after);
+}
+
+TEST_CASE("every port gets its own line assembler", "[reactor]") {
+	auto ptys = std::vector<std::unique_ptr<pty>>{};
+	auto ports = std::vector<std::unique_ptr<line_port>>{};
+	auto r = io_reactor{};
+	for (auto i = 0; i < 8; ++i) {
+		ptys.push_back(std::make_unique<pty>());
+		ports.push_back(std::make_unique<line_port>(ptys.back()->slave));
+		r.watch(ptys.back()->slave,
+				[&lp = *ports.back()](bool) { return lp.on_readable(); });
+	}
+	REQUIRE(r.watched() == 8);
+
+	// lines split across writes and ports written in turn
+	for (auto k = 0; k < 100; ++k) {
+		for (auto i = size_t{0}; i < ptys.size(); ++i) {
+			ptys[i]->send("imu;" + std::to_string(k) + ";1;2;3");
+			ptys[i]->send(i % 2 == 0 ? ";4;5;6\n" : ";4;5;6\ngpsrmc;bad\n");
+		}
+	}
+	for (auto i = size_t{0}; i < ports.size(); ++i) {
+		INFO("port " << i);
+		REQUIRE(eventually([&] { return ports[i]->imus == 100; }));
+		CHECK(ports[i]->lines == (i % 2 == 0 ? 100 : 200));
+	}
+}
+
+TEST_CASE("a port that goes away is dropped", "[reactor]") {
+	auto p = pty{};
+	auto hung_up = std::atomic<bool>{false};
+	auto r = io_reactor{};
+	r.watch(p.slave, [&](bool hangup) {
+		auto b = std::array<char, 64>{};
+		while (read(p.slave, b.data(), b.size()) > 0) {
+		}
+		hung_up = hung_up || hangup;
+		return true;
+	});
+
+	p.close_master();
+	REQUIRE(eventually([&] { return hung_up.load(); }));
+	REQUIRE(eventually([&] { return r.watched() == 0; }));
+}
+
+TEST_CASE("unwatched ports are not called back", "[reactor]") {
+	auto p = pty{};
+	auto calls = std::atomic<size_t>{0};
+	auto r = io_reactor{};
+	r.watch(p.slave, [&](bool) {
+		++calls;
+		return true;
+	});
+	r.unwatch(p.slave);
+	CHECK(r.watched() == 0);
+
+	p.send("imu;1;2;3;4;5;6;7\n");
+	using namespace std::chrono_literals;
+	std::this_thread::sleep_for(50ms);
+	CHECK(calls == 0);
+}
@@ -0,0 +1,261 @@
+#include <catch2/catch.hpp>
+
+#include "minmax_lod.hpp"
+#include "paged_columns.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+using store = paged_columns<double, 2>;
+
+// the rows of s in order, without the copies that start the pages
+static auto rows_of(const store &s) -> std::vector<store::row> {
+	auto out = std::vector<store::row>{};
+	for (const auto &p : s.pages()) {
+		for (auto i = out.empty() ? 0 : size_t{1}; i < p.size(); ++i) {
+			out.push_back({p.cols[0][i], p.cols[1][i]});
+		}
+	}
+	return out;
+}
+
+// pages of rows, each after the first starting on the last row of the
+// previous one, as the store lays them out
+static void check_pages(const store &s) {
+	const auto &ps = s.pages();
+	for (auto i = size_t{1}; i < ps.size(); ++i) {
+		REQUIRE(ps[i].front(0) == ps[i - 1].back(0));
+		REQUIRE(ps[i].front(1) == ps[i - 1].back(1));
+	}
+}
+
+TEST_CASE("rows are split in pages that join up", "[paged_columns]") {
+	auto s = store{8};
+	CHECK(s.empty());
+	CHECK(s.size() == 0);
+	for (auto i = 0; i < 100; ++i) {
+		s.push({double(i), -double(i)});
+	}
+	check_pages(s);
+	CHECK(s.size() == 100);
+	// 8 rows in the first page, 7 new ones and the copy in the others
+	CHECK(s.pages().size() == 1 + (100 - 8 + 6) / 7);
+	CHECK(s.bytes() == s.pages().size() * s.page_bytes());
+	const auto rows = rows_of(s);
+	REQUIRE(rows.size() == 100);
+	for (auto i = 0; i < 100; ++i) {
+		REQUIRE(rows[size_t(i)][0] == i);
+		REQUIRE(rows[size_t(i)][1] == -i);
+	}
+	CHECK(s.front(0) == 0);
+	CHECK(s.back(0) == 99);
+
+	s.replace_back({99, 1});
+	CHECK(s.back_row() == store::row{99, 1});
+
+	// too small a page could not hold the copy and a new row
+	auto tiny = store{0};
+	tiny.push({1, 1});
+	tiny.push({2, 2});
+	tiny.push({3, 3});
+	CHECK(tiny.size() == 3);
+	CHECK(rows_of(tiny).size() == 3);
+}
+
+TEST_CASE("time retention evicts whole pages across boundaries",
+		  "[paged_columns]") {
+	// keys 0.1 s apart, pages of 16 rows, windows shorter than a step and
+	// spanning a page boundary
+	for (const auto keep_s : {0.05, 1.5, 2.0, 3.7}) {
+		INFO("keep " << keep_s << " s");
+		auto s = store{16};
+		for (auto i = 0; i < 1'000; ++i) {
+			const auto t = 0.1 * i;
+			s.push({t, double(i)});
+			s.trim({.seconds = keep_s});
+
+			check_pages(s);
+			const auto &ps = s.pages();
+			const auto oldest = t - keep_s;
+			// the front page still has a key in the window, or it is the
+			// only page
+			REQUIRE((ps.size() == 1 || ps.front().back(0) >= oldest));
+			// and nothing in the window was dropped
+			REQUIRE(s.front(0) <= std::max(oldest, 0.0));
+			// the retained rows are the most recent ones, in order
+			const auto rows = rows_of(s);
+			REQUIRE(rows.back()[1] == i);
+			REQUIRE(rows.size() == s.size());
+			REQUIRE(rows.front()[1] == i - double(rows.size() - 1));
+		}
+	}
+}
+
+TEST_CASE("the byte budget holds a whole number of pages",
+		  "[paged_columns]") {
+	auto s = store{16};
+	const auto budget = 5 * s.page_bytes() + s.page_bytes() / 2;
+	for (auto i = 0; i < 1'000; ++i) {
+		s.push({double(i), 0});
+		s.trim({.bytes = budget});
+		REQUIRE(s.bytes() <= budget);
+		REQUIRE(s.back(0) == i);
+		check_pages(s);
+	}
+	CHECK(s.pages().size() == 5);
+	// 16 rows in each of the 5 pages, one of them a copy but the first
+	const auto rows = rows_of(s);
+	CHECK(rows.size() == s.size());
+	CHECK(rows.front()[0] == 999 - double(rows.size() - 1));
+
+	// the page being written is kept whatever the budget
+	s.trim({.bytes = 1});
+	CHECK(s.pages().size() == 1);
+	CHECK(s.back(0) == 999);
+}
+
+TEST_CASE("drop_before keeps the page that holds the boundary",
+		  "[paged_columns]") {
+	auto s = store{10};
+	for (auto i = 0; i < 100; ++i) {
+		s.push({double(i), 0});
+	}
+	for (const auto oldest : {0.0, 8.0, 9.0, 10.0, 17.5, 18.0, 55.0, 1e9}) {
+		INFO("oldest " << oldest);
+		s.drop_before(oldest);
+		const auto &ps = s.pages();
+		REQUIRE((ps.size() == 1 || ps.front().back(0) >= oldest));
+		// nothing newer than oldest was dropped
+		REQUIRE(s.front(0) <= std::max(oldest, 0.0));
+		REQUIRE(s.back(0) == 99);
+		check_pages(s);
+	}
+	CHECK(s.pages().size() == 1);
+}
+
+TEST_CASE("evicted pages are reused", "[paged_columns]") {
+	auto s = store{4};
+	for (auto i = 0; i < 1'000; ++i) {
+		s.push({double(i), 0});
+		s.trim({.seconds = 10});
+	}
+	const auto rows = rows_of(s);
+	REQUIRE(!rows.empty());
+	CHECK(rows.back()[0] == 999);
+	for (auto i = size_t{1}; i < rows.size(); ++i) {
+		REQUIRE(rows[i][0] == rows[i - 1][0] + 1);
+	}
+	s.clear();
+	CHECK(s.empty());
+	s.push({1, 2});
+	CHECK(s.size() == 1);
+	CHECK(s.back_row() == store::row{1, 2});
+}
+
+using lod = minmax_lod<2>;
+
+// the rows of a level, without the page copies
+static auto level_rows(const lod::level &l) {
+	auto out = std::vector<lod::level::row>{};
+	for (const auto &p : l.pages()) {
+		for (auto i = out.empty() ? 0 : size_t{1}; i < p.size(); ++i) {
+			auto r = lod::level::row{};
+			for (auto c = size_t{0}; c < lod::columns; ++c) {
+				r[c] = p.cols[c][i];
+			}
+			out.push_back(r);
+		}
+	}
+	return out;
+}
+
+// every row of level l against min and max computed over its bucket. the
+// sample at index i has time i, first is the time of the oldest row kept
+static void check_level(const lod &m, size_t l,
+						const std::vector<lod::values> &vs, size_t first) {
+	INFO("level " << l);
+	const auto b = lod::bucket(l);
+	const auto rows = level_rows(m.at(l));
+	// the buckets are aligned on the first sample ever pushed
+	const auto first_bucket = first / b;
+	const auto buckets = (vs.size() + b - 1) / b;
+	REQUIRE(rows.size() == buckets - first_bucket);
+	for (auto r = size_t{0}; r < rows.size(); ++r) {
+		const auto from = (first_bucket + r) * b;
+		const auto to = std::min(from + b, vs.size());
+		REQUIRE(rows[r][0] == float(from));
+		for (auto ch = size_t{0}; ch < 2; ++ch) {
+			auto lo = vs[from][ch];
+			auto hi = lo;
+			for (auto i = from; i < to; ++i) {
+				lo = std::min(lo, vs[i][ch]);
+				hi = std::max(hi, vs[i][ch]);
+			}
+			REQUIRE(rows[r][lod::lo(ch)] == lo);
+			REQUIRE(rows[r][lod::hi(ch)] == hi);
+		}
+	}
+}
+
+TEST_CASE("every level is the min and max of its buckets", "[minmax_lod]") {
+	auto rng = std::mt19937{11};
+	auto val = std::uniform_real_distribution<float>{-1000, 1000};
+	auto m = lod{};
+	auto vs = std::vector<lod::values>{};
+	// checked on partial last buckets too, and past a page of level 1
+	for (const auto n : {size_t{1}, size_t{7}, size_t{8}, size_t{65},
+						 size_t{4'099}, size_t{300'000}}) {
+		INFO(n << " samples");
+		while (vs.size() < n) {
+			vs.push_back({val(rng), val(rng)});
+			m.push(float(vs.size() - 1), vs.back());
+		}
+		for (auto l = size_t{1}; l <= lod::levels; ++l) {
+			check_level(m, l, vs, 0);
+		}
+	}
+}
+
+TEST_CASE("levels follow the eviction of the samples", "[minmax_lod]") {
+	auto m = lod{};
+	auto vs = std::vector<lod::values>{};
+	for (auto i = 0; i < 200'000; ++i) {
+		const auto v = float((i * 7919) % 1000);
+		vs.push_back({v, -v});
+		m.push(float(i), vs.back());
+	}
+	m.drop_before(150'000);
+	for (auto l = size_t{1}; l <= lod::levels; ++l) {
+		const auto &lv = m.at(l);
+		// whole pages go: the front one still reaches the boundary
+		const auto &ps = lv.pages();
+		REQUIRE((ps.size() == 1 || ps.front().back(0) >= 150'000));
+		REQUIRE(lv.front(0) <= 150'000);
+		// what is left are the same rows as before, from a bucket boundary
+		const auto first = size_t(lv.front(0));
+		REQUIRE(first % lod::bucket(l) == 0);
+		check_level(m, l, vs, first);
+	}
+}
+
+TEST_CASE("pick takes the finest level within the points", "[minmax_lod]") {
+	CHECK(lod::pick(1'000, 2'000) == 0);
+	CHECK(lod::pick(2'000, 2'000) == 0);
+	CHECK(lod::pick(2'001, 2'000) == 1);
+	// level 1 draws 2 points per 8 samples
+	CHECK(lod::pick(8'000, 2'000) == 1);
+	CHECK(lod::pick(8'008, 2'000) == 2);
+	CHECK(lod::pick(size_t{1} << 40, 2'000) == lod::levels);
+	for (auto n = size_t{1}; n < 10'000'000; n = n * 3 + 1) {
+		const auto l = lod::pick(n, 1'000);
+		const auto points = l == 0 ? n : 2 * (n / lod::bucket(l));
+		REQUIRE((points <= 1'000 || l == lod::levels));
+		// the level before draws too many
+		if (l > 0) {
+			const auto finer = l == 1 ? n : 2 * (n / lod::bucket(l - 1));
+			REQUIRE(finer > 1'000);
+		}
+	}
+}
@@ -0,0 +1,219 @@
+#include <catch2/catch.hpp>
+
+#include "time_base.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+// a device whose millisecond counter runs slow by ppm against the host,
+// read with a latency between 0 and jitter_ms
+struct simulated_device {
+	double ppm;
+	double jitter_ms;
+	uint32_t counter;
+	double period_ms = 17;
+	std::mt19937 rng{19};
+	double device_ms = 0; // since the start, exact
+
+	// host time the sample is read at, us, and the ideal one without latency
+	struct sample {
+		uint32_t ts;
+		int64_t host_us;
+		double true_host_ms;
+	};
+
+	auto next() -> sample {
+		device_ms += period_ms;
+		const auto true_host = device_ms / (1 - ppm * 1e-6);
+		auto latency = std::uniform_real_distribution<double>{0, jitter_ms};
+		const auto host = true_host + latency(rng);
+		return {counter + uint32_t(device_ms),
+				int64_t(std::llround(host * 1000)), true_host};
+	}
+};
+
+TEST_CASE("a fit is empty before its first sample", "[clock_fit]") {
+	auto fit = clock_fit{};
+	CHECK(!fit.offset(0));
+	CHECK(!fit.drift());
+	fit.add(100, 42);
+	REQUIRE(fit.offset(100));
+	CHECK(*fit.offset(100) == 42);
+	CHECK(*fit.offset(1e6) == 42);
+	CHECK(!fit.drift());
+	fit.reset();
+	CHECK(!fit.offset(0));
+}
+
+TEST_CASE("the fit recovers a drift through the latency", "[clock_fit]") {
+	// offset = host - device grows by 50 us per second of a slow device
+	auto fit = clock_fit{};
+	auto rng = std::mt19937{7};
+	auto latency = std::uniform_real_distribution<double>{0, 20};
+	for (auto x = 0.; x < 600'000; x += 10) {
+		fit.add(x, 1'000 + 50e-6 * x + latency(rng));
+	}
+	REQUIRE(fit.drift());
+	CHECK(*fit.drift() == Approx(50e-6).margin(0.5e-6));
+	// the line follows the least delayed samples, not the average
+	CHECK(*fit.offset(600'000) == Approx(1'000 + 30).margin(0.5));
+}
+
+TEST_CASE("a slow device clock is measured and aligned", "[device_clock]") {
+	// the counter wraps a minute in
+	auto dev = simulated_device{
+		.ppm = 50, .jitter_ms = 20, .counter = UINT32_MAX - 60'000};
+	auto clock = device_clock{};
+
+	const auto first = dev.next();
+	const auto t0 = clock.tick(first.ts, first.host_us);
+	CHECK(t0.ms == 0);
+	CHECK(t0.dt == 0);
+	CHECK(t0.t == Approx(double(first.host_us) / 1e6));
+
+	auto worst = 0.;
+	auto last_ms = t0.ms;
+	// 20 minutes
+	for (auto i = 0; i < 70'000; ++i) {
+		const auto s = dev.next();
+		const auto t = clock.tick(s.ts, s.host_us);
+		REQUIRE(t.ms > last_ms);
+		REQUIRE(!t.gap);
+		REQUIRE(t.dt == Approx(0.017f));
+		last_ms = t.ms;
+		// aligned once a few windows are in
+		if (i > 10'000) {
+			worst = std::max(worst, std::abs(t.t * 1000 - s.true_host_ms));
+		}
+	}
+	const auto st = clock.stats();
+	CHECK(st.wraps == 1);
+	CHECK(st.gaps == 0);
+	CHECK(st.resets == 0);
+	CHECK(st.period == Approx(17));
+	REQUIRE(st.drift_ppm);
+	CHECK(*st.drift_ppm == Approx(50).margin(1));
+	CHECK(worst < 2);
+}
+
+TEST_CASE("the timeline never goes back through read jitter",
+		  "[device_clock]") {
+	// up to 60 ms of latency, the first sample read the latest: until its
+	// first window is in the fit follows the fastest read so far, and it
+	// steps back by more than a period as it finds faster ones
+	for (const auto ppm : {0., 50., -200.}) {
+		INFO(ppm << " ppm");
+		auto dev = simulated_device{
+			.ppm = ppm, .jitter_ms = 60, .counter = 1'000};
+		auto clock = device_clock{};
+		const auto first = dev.next();
+		const auto late = int64_t(std::llround(first.true_host_ms * 1000)) +
+						  60'000;
+		auto prev = clock.tick(first.ts, late);
+		auto worst = 0.;
+		for (auto i = 0; i < 20'000; ++i) {
+			const auto s = dev.next();
+			const auto t = clock.tick(s.ts, s.host_us);
+			REQUIRE(t.t >= prev.t);
+			REQUIRE(t.dt >= 0);
+			prev = t;
+			if (i > 10'000) {
+				worst = std::max(worst, std::abs(t.t * 1000 - s.true_host_ms));
+			}
+		}
+		// held back while the fit settled, aligned after
+		CHECK(worst < 5);
+	}
+}
+
+TEST_CASE("lost samples and device resets", "[device_clock]") {
+	auto clock = device_clock{};
+	auto host = int64_t{1'000'000};
+	auto ts = uint32_t{5'000};
+	for (auto i = 0; i < 100; ++i) {
+		clock.tick(ts += 10, host += 10'000);
+	}
+	// four samples lost
+	const auto gap = clock.tick(ts += 50, host += 50'000);
+	CHECK(gap.gap);
+	CHECK(gap.dt == Approx(0.05f));
+	CHECK(clock.stats().gaps == 1);
+	CHECK(clock.stats().missed == 4);
+
+	// the device restarts: its counter goes back to 0, the unwrapped one
+	// carries on where the host clock says
+	const auto before = clock.tick(ts += 10, host += 10'000);
+	const auto reset = clock.tick(3, host += 10'000);
+	CHECK(reset.gap);
+	CHECK(reset.ms > before.ms);
+	CHECK(reset.t == Approx(before.t + 0.01).margin(1e-3));
+	CHECK(clock.stats().resets == 1);
+	const auto after = clock.tick(13, host += 10'000);
+	CHECK(!after.gap);
+	CHECK(after.ms == reset.ms + 10);
+}
+
+TEST_CASE("a stalled reader is not a device reset", "[device_clock]") {
+	auto clock = device_clock{};
+	auto host = int64_t{1'000'000};
+	auto ts = uint32_t{5'000};
+	for (auto i = 0; i < 100; ++i) {
+		clock.tick(ts += 10, host += 10'000);
+	}
+	// the reader stalls for 1.5 s, then takes the backlog of 150 samples
+	// within a few ms: the early ones are read up to 1.5 s late
+	auto prev = clock.tick(ts += 10, host += 10'000);
+	host += 1'500'000;
+	for (auto i = 0; i < 150; ++i) {
+		const auto t = clock.tick(ts += 10, host += 20);
+		CHECK(!t.gap);
+		CHECK(t.ms == prev.ms + 10);
+		CHECK(t.dt == Approx(0.01f));
+		CHECK(t.t >= prev.t);
+		prev = t;
+	}
+	CHECK(clock.stats().resets == 0);
+	// the times kept to the device counter, not to the late reads
+	CHECK(prev.t == Approx(double(host) / 1e6).margin(0.01));
+}
+
+TEST_CASE("gps fixes map on the host timeline across midnight",
+		  "[gps_clock]") {
+	auto clock = gps_clock{};
+	// first fix: the host time it was read at, nothing to fit yet
+	auto host = int64_t{123'456'789};
+	CHECK(clock.tick(235950, host) == Approx(double(host) / 1e6));
+
+	auto prev = double(host) / 1e6;
+	const auto fixes = {235951, 235952, 235958, 235959, 0,
+						1,		2,		59,		100,	101};
+	auto sod = 23 * 3600 + 59 * 60 + 50;
+	for (const auto hhmmss : fixes) {
+		const auto s = hhmmss / 10000 * 3600 + hhmmss / 100 % 100 * 60 +
+					   hhmmss % 100;
+		const auto step = (s - sod + 24 * 3600) % (24 * 3600);
+		sod = s;
+		host += int64_t(step) * 1'000'000 + (hhmmss % 3) * 1'000;
+		const auto t = clock.tick(uint32_t(hhmmss), host);
+		INFO(hhmmss);
+		// a second per second, the day does not go back at midnight
+		CHECK(t - prev == Approx(step).margin(0.005));
+		prev = t;
+	}
+}
+
+TEST_CASE("a gps receiver that jumps in time starts a new fit",
+		  "[gps_clock]") {
+	auto clock = gps_clock{};
+	auto host = int64_t{0};
+	for (auto s = 120000u; s < 120030; ++s) {
+		clock.tick(s, host += 1'000'000);
+	}
+	// the receiver got its time from the satellites: an hour off
+	const auto t = clock.tick(130031, host += 1'000'000);
+	CHECK(t == Approx(double(host) / 1e6));
+	const auto next = clock.tick(130032, host += 1'000'000);
+	CHECK(next - t == Approx(1).margin(1e-3));
+}
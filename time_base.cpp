@@ -0,0 +1,160 @@
+#include "time_base.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+auto host_us() -> int64_t {
+	using namespace std::chrono;
+	static const auto start = steady_clock::now();
+	return duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+void clock_fit::add(double device_ms, double offset_ms) {
+	const auto p = point{device_ms, offset_ms};
+	if (!window) {
+		window = p;
+		window_start = device_ms;
+		return;
+	}
+	if (p.y < window->y) {
+		window = p;
+	}
+	if (device_ms - window_start >= cfg.window_ms) {
+		fit(*window);
+		window.reset();
+	}
+}
+
+void clock_fit::fit(const point &p) {
+	auto w = 1.;
+	if (fitted >= 2) {
+		const auto r = std::abs(p.y - *offset(p.x));
+		w = r > cfg.huber_ms ? cfg.huber_ms / r : 1.;
+	}
+	if (fitted == 0) {
+		// the sums are kept small, the offsets can be 2^32 ms
+		x0 = p.x;
+		y0 = p.y;
+	}
+	const auto x = p.x - x0;
+	const auto y = p.y - y0;
+	const auto keep = 1 - 1 / cfg.memory;
+	s = s * keep + w;
+	sx = sx * keep + w * x;
+	sy = sy * keep + w * y;
+	sxx = sxx * keep + w * x * x;
+	sxy = sxy * keep + w * x * y;
+	++fitted;
+}
+
+auto clock_fit::offset(double device_ms) const -> std::optional<double> {
+	if (fitted == 0) {
+		return window ? std::optional{window->y} : std::nullopt;
+	}
+	const auto xm = sx / s;
+	const auto ym = sy / s;
+	return y0 + ym + drift().value_or(0) * (device_ms - x0 - xm);
+}
+
+auto clock_fit::drift() const -> std::optional<double> {
+	const auto den = sxx - sx * sx / s;
+	if (fitted < 2 || den <= 0) {
+		return std::nullopt;
+	}
+	return (sxy - sx * sy / s) / den;
+}
+
+void clock_fit::reset() { *this = clock_fit{cfg}; }
+
+auto device_clock::tick(uint32_t ts, int64_t host) -> device_tick {
+	auto t = advance(ts, host);
+	// the fit moves as it learns, early on by as much as the read latency:
+	// the time it gives a sample can be before the one it gave the sample
+	// before. the stores and the plots search the times assuming they never
+	// go back, the timeline waits for the fit to catch up instead
+	t.t = std::max(t.t, last_t);
+	last_t = t.t;
+	return t;
+}
+
+auto device_clock::advance(uint32_t ts, int64_t host) -> device_tick {
+	const auto host_ms = double(host) / 1000.;
+	const auto at = [&](uint64_t ms) {
+		return (double(ms) + *fit.offset(double(ms))) / 1000.;
+	};
+	if (!last) {
+		last = ts;
+		fit.add(double(unwrapped), host_ms - double(unwrapped));
+		return {.ms = unwrapped, .t = at(unwrapped)};
+	}
+
+	// unsigned difference: a step across the wrap of the counter is as
+	// short as any other, a step back looks like a huge one
+	const auto step = ts - *last;
+	const auto wrapped = ts < *last;
+	last = ts;
+
+	const auto next = double(unwrapped + step);
+	const auto expected = *fit.offset(next);
+	// a sample read late is latency, not a jump: a stalled reader takes
+	// seconds of backlog at once. only a counter that goes back or runs
+	// ahead of the host clock restarted
+	if (step > UINT32_MAX / 2 || host_ms - next - expected < -cfg.reset_ms) {
+		// continue the counter where the fit puts the host time of this
+		// sample: the offset to the host does not move. the latency of
+		// this one sample ends up in it, the forgetting fades it out
+		++counts.resets;
+		unwrapped = std::max(unwrapped,
+							 uint64_t(std::max(host_ms - expected, 0.)));
+		fit.add(double(unwrapped), host_ms - double(unwrapped));
+		return {.ms = unwrapped, .t = at(unwrapped), .gap = true};
+	}
+	counts.wraps += wrapped;
+	unwrapped += step;
+	fit.add(double(unwrapped), host_ms - double(unwrapped));
+
+	auto t = device_tick{
+		.ms = unwrapped, .t = at(unwrapped), .dt = float(step) / 1000.f};
+	if (period > 0 && float(step) > cfg.gap_factor * period) {
+		t.gap = true;
+		++counts.gaps;
+		counts.missed += size_t(std::lround(float(step) / period)) - 1;
+	} else if (step > 0) {
+		// slow average, the jitter of single steps does not move it
+		period = period == 0 ? float(step)
+							 : period + (float(step) - period) / 64;
+	}
+	if (step > cfg.max_step_ms) {
+		t.dt = 0;
+	}
+	return t;
+}
+
+auto device_clock::stats() const -> clock_stats {
+	auto s = counts;
+	s.period = period;
+	if (const auto d = fit.drift()) {
+		s.drift_ppm = *d * 1e6;
+	}
+	return s;
+}
+
+auto gps_clock::tick(uint32_t hhmmss, int64_t host) -> double {
+	const auto sod =
+		hhmmss / 10000 * 3600 + hhmmss / 100 % 100 * 60 + hhmmss % 100;
+	if (last_sod && sod + 12 * 3600 < *last_sod) {
+		++days;
+	}
+	last_sod = sod;
+
+	const auto utc_ms = double(days * 24 * 3600 + sod) * 1000.;
+	const auto offset = double(host) / 1000. - utc_ms;
+	// the receiver restarted, or got its time from the satellites at last
+	if (const auto o = fit.offset(utc_ms);
+		o && std::abs(offset - *o) > cfg.reset_ms) {
+		fit.reset();
+	}
+	fit.add(utc_ms, offset);
+	return (utc_ms + *fit.offset(utc_ms)) / 1000.;
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+
+// host monotonic clock in microseconds since the first call, what the reader
+// threads stamp the records with when they come out of the port. the common
+// timeline every source is aligned on is this clock in seconds
+auto host_us() -> int64_t;
+
+// online fit of offset = host - device as a linear function of the device
+// time, in ms. the samples are reduced to the minimum offset over windows of
+// device time: the minimum is the sample that waited the least between the
+// device and the host, latency spikes and batched reads drop out. the window
+// minima go through a least squares fit with exponential forgetting and
+// huber weights, so an odd window pulls the line only so much. O(1) per
+// sample and per window
+class clock_fit {
+  public:
+	struct config {
+		double window_ms = 2'000;
+		double memory = 150; // windows, time constant of the forgetting
+		double huber_ms = 2; // residuals over this weigh less and less
+	};
+
+	clock_fit() : clock_fit(config{}) {}
+	explicit clock_fit(const config &c) : cfg{c} {}
+
+	void add(double device_ms, double offset_ms);
+	// host - device at device_ms, empty before the first sample
+	auto offset(double device_ms) const -> std::optional<double>;
+	// slope of the offset, empty until two windows have been fitted
+	auto drift() const -> std::optional<double>;
+	void reset();
+
+  private:
+	struct point {
+		double x = 0, y = 0;
+	};
+	void fit(const point &p);
+
+	config cfg;
+	std::optional<point> window{};
+	double window_start = 0;
+	// weighted sums of the fitted minima, relative to the first one
+	double x0 = 0, y0 = 0;
+	double s = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+	size_t fitted = 0;
+};
+
+// one imu::ts as the integrators and the plots want it
+struct device_tick {
+	uint64_t ms = 0; // device time, unwrapped: never goes back
+	double t = 0;	 // on the host timeline, s: never goes back either
+	float dt = 0;	 // s since the previous sample, 0 if not to integrate
+	bool gap = false; // samples were lost or the clock jumped before this
+};
+
+struct clock_stats {
+	size_t wraps = 0;  // of the 32 bit millisecond counter
+	size_t gaps = 0;   // steps longer than gap_factor periods
+	size_t missed = 0; // samples estimated lost in the gaps
+	size_t resets = 0; // device restarts and other jumps of the counter
+	float period = 0;  // ms, typical step between samples
+	// device clock rate against the host one, parts per million. positive
+	// when the device clock is slow. empty until two windows are fitted
+	std::optional<double> drift_ppm{};
+};
+
+// follows the millisecond counter of one device: unwraps it to 64 bits,
+// turns it into integration steps, tells gaps from the normal jitter and
+// maps it on the host timeline through a clock_fit.
+// a step back, or one that puts the counter more than reset_ms ahead of the
+// host clock, is a reset of the device (or a corrupted timestamp): the
+// counter is re-anchored where the host clock says it should be and the fit
+// goes on undisturbed. samples read late are never resets
+class device_clock {
+  public:
+	struct config {
+		float gap_factor = 2.5f; // steps over this many periods are gaps
+		uint32_t max_step_ms = 500; // longer steps are not integrated
+		double reset_ms = 1'000;
+		clock_fit::config fit{};
+	};
+
+	device_clock() : device_clock(config{}) {}
+	explicit device_clock(const config &c) : cfg{c}, fit{c.fit} {}
+
+	// ts of the next sample and the host time it was read at
+	auto tick(uint32_t ts, int64_t host) -> device_tick;
+
+	auto stats() const -> clock_stats;
+
+  private:
+	// tick() before t is kept from going back
+	auto advance(uint32_t ts, int64_t host) -> device_tick;
+
+	config cfg;
+	clock_fit fit;
+	std::optional<uint32_t> last{};
+	uint64_t unwrapped = 0;
+	double last_t = -std::numeric_limits<double>::infinity();
+	float period = 0;
+	clock_stats counts{};
+};
+
+// maps the utc time of day of the gps fixes (hhmmss) on the host timeline.
+// the fixes are a second apart and their time is whole seconds, the fit
+// windows are long accordingly
+class gps_clock {
+  public:
+	struct config {
+		double reset_ms = 2'000;
+		clock_fit::config fit{.window_ms = 60'000, .memory = 30};
+	};
+
+	gps_clock() : gps_clock(config{}) {}
+	explicit gps_clock(const config &c) : cfg{c}, fit{c.fit} {}
+
+	// hhmmss of a fix and the host time it was read at, returns the time
+	// of the fix on the host timeline in s
+	auto tick(uint32_t hhmmss, int64_t host) -> double;
+
+  private:
+	config cfg;
+	clock_fit fit;
+	std::optional<uint32_t> last_sod{}; // second of the day
+	uint64_t days = 0;					// midnights crossed
+};